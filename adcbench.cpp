@@ -0,0 +1,422 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <functional>
+#include <filesystem>
+#include <thread>
+#include "adcdefs.h"
+#include "logger.h"
+#include "packetdecoder.h"
+#include "rotatingfile.h"
+#include "textencoder.h"
+#include "datawriter.h"
+#include "simdevice.h"
+#include "chartbuffer.h"
+#include "fft.h"
+#include "mseedwriter.h"
+
+namespace fs = std::filesystem;
+
+// Synthetic packets in the benchmark set
+#define BENCH_PACKETS 256
+
+/**
+ * Заполнение пакета синтетическими данными ЛА-И24USB: чередование
+ * каналов 0..3, 24-битные отсчеты синусоиды с шумом.
+ * @param buf - пакет длиной DATABUF_LEN.
+ * @param n - номер пакета.
+ */
+static void makePacket(uint8_t *buf, int n) {
+    for (int i = 0; i < DATABUF_LEN / 4; i++) {
+        int chan = i % NUM_CHANNELS;
+        int sample = n * CHANBUF_LEN + i / NUM_CHANNELS;
+        int32_t value = (int32_t)(4000000 * sin(sample * 0.01 * (chan + 1))) + rand() % 1000 - 500;
+        buf[i * 4] = chan << 4;
+        buf[i * 4 + 1] = value & 0xff;
+        buf[i * 4 + 2] = (value >> 8) & 0xff;
+        buf[i * 4 + 3] = (value >> 16) & 0xff;
+    }
+}
+
+/**
+ * Запуск одного теста и вывод результата.
+ * @param name - имя теста.
+ * @param iterations - число повторений.
+ * @param samples - число отсчетов за одно повторение.
+ * @param bytes - число байт за одно повторение.
+ * @param fn - тестируемая функция, получает номер повторения.
+ */
+static void runBench(const char *name, long iterations, double samples, double bytes,
+                     const std::function<void(long)> &fn) {
+    fn(0);
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        fn(i);
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-28s %12.1f ns/iter %14.0f samples/s %10.1f MB/s\n", name, sec * 1e9 / iterations,
+           samples * iterations / sec, bytes * iterations / sec / 1e6);
+}
+
+/**
+ * Чтение big-endian числа.
+ * @param p - данные.
+ * @param bytes - длина числа (2 или 4 байта).
+ * @return - число.
+ */
+static uint32_t getBE(const uint8_t *p, int bytes) {
+    uint32_t v = 0;
+    for (int i = 0; i < bytes; i++) {
+        v = v << 8 | p[i];
+    }
+    return v;
+}
+
+/**
+ * Распаковка записи miniSEED со сжатием Steim2 по описанию формата,
+ * без использования кода MseedWriter.
+ * @param rec - запись.
+ * @param recLen - длина записи.
+ * @param out - распакованные отсчеты (дописываются в конец).
+ * @return - согласуются ли данные с заголовком и константами интегрирования.
+ */
+static bool decodeSteim2Record(const uint8_t *rec, int recLen, std::vector<int32_t> *out) {
+    size_t n = getBE(rec + 30, 2);
+    int offset = getBE(rec + 44, 2);
+    if (rec[52] != MSEED_STEIM2 || n == 0) {
+        return false;
+    }
+    std::vector<int32_t> diffs;
+    int32_t x0 = 0, xn = 0;
+    for (int f = 0; f < (recLen - offset) / STEIM_FRAME_LEN; f++) {
+        const uint8_t *frame = rec + offset + f * STEIM_FRAME_LEN;
+        uint32_t ctrl = getBE(frame, 4);
+        for (int w = 1; w < STEIM_FRAME_WORDS; w++) {
+            uint32_t v = getBE(frame + w * 4, 4);
+            int c = (ctrl >> (30 - 2 * w)) & 3, dnib = v >> 30;
+            if (f == 0 && w == 1) {
+                x0 = v;
+                continue;
+            }
+            if (f == 0 && w == 2) {
+                xn = v;
+                continue;
+            }
+            int count = 0, bits = 0;
+            if (c == 1) {
+                count = 4, bits = 8;
+            } else if (c == 2) {
+                count = dnib == 1 ? 1 : dnib == 2 ? 2 : 3;
+                bits = dnib == 1 ? 30 : dnib == 2 ? 15 : 10;
+            } else if (c == 3) {
+                count = 5 + dnib;
+                bits = dnib == 0 ? 6 : dnib == 1 ? 5 : 4;
+            }
+            for (int k = 0; k < count; k++) {
+                int32_t d = (v >> (bits * (count - 1 - k))) & ((1u << bits) - 1);
+                diffs.push_back(d << (32 - bits) >> (32 - bits));
+            }
+        }
+    }
+    if (diffs.size() < n) {
+        return false;
+    }
+    // Первая разность относится к предыдущей записи, первый отсчет задан константой X0
+    int32_t x = x0;
+    out->push_back(x);
+    for (size_t i = 1; i < n; i++) {
+        x += diffs[i];
+        out->push_back(x);
+    }
+    return x == xn;
+}
+
+/**
+ * Проверка сжатия Steim2: запись участков с разностями всех размеров
+ * и сравнение с результатом независимой распаковки.
+ * @param root - каталог данных.
+ * @param logger - журнал.
+ * @param recLen - длина записи miniSEED.
+ * @return - совпали ли распакованные отсчеты с записанными.
+ */
+static bool checkSteim2(const std::string &root, Logger *logger, int recLen) {
+    std::vector<int32_t> expected;
+    int32_t x = 0;
+    for (int bits : {1, 4, 5, 6, 8, 10, 15, 24, 8, 4}) {
+        for (int i = 0; i < 1024; i++) {
+            x += rand() % (1 << bits) - (1 << (bits - 1));
+            x = std::max(-(1 << 23), std::min((1 << 23) - 1, x));
+            expected.push_back(x);
+        }
+    }
+    fs::create_directories(root);
+    {
+        MseedWriter writer(root, 0, true, 5, 800, 0, recLen, "XX", "ADC", logger);
+        for (size_t i = 0; i < expected.size(); i += CHANBUF_LEN) {
+            int32_t chunk[CHANBUF_LEN];
+            for (int k = 0; k < CHANBUF_LEN; k++) {
+                chunk[k] = (int32_t)((uint32_t)expected[i + k] << 8);
+            }
+            int64_t usec = (int64_t)1600000000 * 1000000 + (int64_t)i * 1000000 / 800;
+            struct timeval tv = {(time_t)(usec / 1000000), (suseconds_t)(usec % 1000000)};
+            writer.write(chunk, CHANBUF_LEN, &tv);
+        }
+    }
+
+    FILE *f = fopen((root + "/data_ch0.mseed").c_str(), "rb");
+    if (f == NULL) {
+        printf("Steim2 round trip (%d): no output file\n", recLen);
+        return false;
+    }
+    std::vector<uint8_t> rec(recLen);
+    std::vector<int32_t> decoded;
+    int records = 0;
+    bool ok = true;
+    while (ok && fread(rec.data(), 1, recLen, f) == (size_t)recLen) {
+        ok = decodeSteim2Record(rec.data(), recLen, &decoded);
+        records++;
+    }
+    fclose(f);
+    ok = ok && decoded == expected;
+    printf("Steim2 round trip (%d): %s, %d records, %zu samples\n", recLen, ok ? "OK" : "FAILED", records,
+           decoded.size());
+    return ok;
+}
+
+/**
+ * Прогон блоков через поток записи с заданными настройками каналов.
+ * @param name - имя теста.
+ * @param root - каталог данных.
+ * @param logger - журнал.
+ * @param blocks - блоки данных.
+ * @param count - число записываемых блоков.
+ * @param aver - коэффициент усреднения.
+ * @param binary - писать двоичные данные.
+ * @param text - писать текстовые данные.
+ * @param format - формат двоичных данных.
+ * @param filter - фильтр понижения частоты.
+ */
+static void runWriterBench(const char *name, const std::string &root, Logger *logger,
+                           const std::vector<DataBlock> &blocks, long count, int aver, bool binary, bool text,
+                           int format = BINARY_BLOCKS, int filter = DECIMATION_MEAN,
+                           const char *extra = "") {
+    GlobalView glView {};
+    glView.dataRoot = QString::fromStdString(root);
+    glView.loggingRoot = QString::fromStdString(root);
+    glView.frequency = 800;
+    glView.meaningDataBuffer = aver;
+    glView.dataInOneFile = false;
+    glView.flushInterval = 5;
+    glView.textTimePrecision = 3;
+    glView.mseedRecordLen = 512;
+    glView.mseedNetwork = "XX";
+    glView.mseedStation = "ADC";
+    std::vector<ChannelView> chSets(NUM_CHANNELS);
+    for (ChannelView &chv : chSets) {
+        chv.enabled = true;
+        chv.saveBinaryData = binary;
+        chv.saveTextData = text;
+        chv.binaryFormat = format;
+        chv.decimationFilter = filter;
+        chv.extraOutputs = extra;
+    }
+
+    DataWriter writer(glView, chSets, logger);
+    auto start = std::chrono::steady_clock::now();
+    writer.start();
+    for (long i = 0; i < count; i++) {
+        DataBlock block = blocks[i % blocks.size()];
+        int64_t usec = (int64_t)1600000000 * 1000000 + i * (int64_t)CHANBUF_LEN * 1000000 / glView.frequency;
+        block.tv.tv_sec = usec / 1000000;
+        block.tv.tv_usec = usec % 1000000;
+        while (!writer.push(block)) {
+            std::this_thread::yield();
+        }
+    }
+    writer.stop();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double samples = (double)count * NUM_CHANNELS * CHANBUF_LEN;
+    if (writer.failed()) {
+        printf("%-28s failed, see %s/datacollect.log\n", name, root.c_str());
+        return;
+    }
+    printf("%-28s %12.1f ns/block %13.0f samples/s %10.1f MB/s\n", name, sec * 1e9 / count,
+           samples / sec, samples * sizeof(int32_t) / sec / 1e6);
+}
+
+/**
+ * Тесты производительности разбора пакетов, усреднения и записи данных.
+ * Использование: adc_bench [каталог для временных файлов] [число блоков записи].
+ */
+int main(int argc, char *argv[]) {
+    std::string tmpl = (argc > 1 ? std::string(argv[1]) : fs::temp_directory_path().string()) + "/adc_bench.XXXXXX";
+    std::vector<char> rootBuf(tmpl.begin(), tmpl.end());
+    rootBuf.push_back('\0');
+    if (mkdtemp(rootBuf.data()) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string root = rootBuf.data();
+    long writerBlocks = argc > 2 ? atol(argv[2]) : 20000;
+    Logger logger(root);
+
+    std::vector<uint8_t> packets(BENCH_PACKETS * DATABUF_LEN);
+    for (int n = 0; n < BENCH_PACKETS; n++) {
+        makePacket(&packets[n * DATABUF_LEN], n);
+    }
+    // Пакет с нарушенным чередованием каналов разбирается построчно
+    std::vector<uint8_t> badPacket(packets.begin(), packets.begin() + DATABUF_LEN);
+    badPacket[DATABUF_LEN - 4] = 0x50;
+
+    PacketDecoder decoder;
+    printf("Packet decoder: %s\n", decoder.isaName());
+    const double PACKET_SAMPLES = NUM_CHANNELS * CHANBUF_LEN;
+
+    std::vector<DataBlock> blocks(BENCH_PACKETS);
+    static float voltsF[NUM_CHANNELS][CHANBUF_LEN];
+    static double voltsD[NUM_CHANNELS][CHANBUF_LEN];
+
+    runBench("decode", 2000000, PACKET_SAMPLES, DATABUF_LEN, [&](long i) {
+        decoder.decode(&packets[(i % BENCH_PACKETS) * DATABUF_LEN], blocks[i % BENCH_PACKETS].ch);
+    });
+    runBench("decode+float volts", 2000000, PACKET_SAMPLES, DATABUF_LEN, [&](long i) {
+        decoder.decode(&packets[(i % BENCH_PACKETS) * DATABUF_LEN], blocks[i % BENCH_PACKETS].ch, voltsF);
+    });
+    runBench("decode+double volts", 2000000, PACKET_SAMPLES, DATABUF_LEN, [&](long i) {
+        decoder.decode(&packets[(i % BENCH_PACKETS) * DATABUF_LEN], blocks[i % BENCH_PACKETS].ch, nullptr, voltsD);
+    });
+    runBench("decode (scalar fallback)", 2000000, PACKET_SAMPLES, DATABUF_LEN, [&](long i) {
+        decoder.decode(badPacket.data(), blocks[i % BENCH_PACKETS].ch);
+    });
+    for (int n = 0; n < BENCH_PACKETS; n++) {
+        decoder.decode(&packets[n * DATABUF_LEN], blocks[n].ch);
+    }
+
+    // Имитатор с максимальной скоростью: формирование запросов по 8 пакетов и их разбор
+    SimDevice sim(&logger, false, SimFaults {0, 0, 0});
+    std::vector<uint8_t> simBuf(8 * DATABUF_LEN);
+    sim.open();
+    sim.start(800, simBuf.size(), 0, 0);
+    runBench("simulator read+decode", 200000, 8 * PACKET_SAMPLES, simBuf.size(), [&](long i) {
+        int len;
+        struct timeval tv;
+        sim.read(simBuf.data(), &len, &tv, 0);
+        for (int p = 0; p < len / DATABUF_LEN; p++) {
+            decoder.decode(&simBuf[p * DATABUF_LEN], blocks[i % BENCH_PACKETS].ch);
+        }
+    });
+    sim.close();
+
+    int32_t meanBuf[CHANBUF_LEN];
+    runBench("meanChanData /2", 5000000, CHANBUF_LEN, CHANBUF_LEN * sizeof(int32_t), [&](long i) {
+        DataWriter::meanChanData(blocks[i % BENCH_PACKETS].ch[i % NUM_CHANNELS], CHANBUF_LEN, meanBuf, 2);
+    });
+    runBench("meanChanData /32", 5000000, CHANBUF_LEN, CHANBUF_LEN * sizeof(int32_t), [&](long i) {
+        DataWriter::meanChanData(blocks[i % BENCH_PACKETS].ch[i % NUM_CHANNELS], CHANBUF_LEN, meanBuf, 32);
+    });
+
+    for (int factor : {2, 32}) {
+        Decimator decimator(factor, 800);
+        std::string name = "CIC+FIR /" + std::to_string(factor) + " (" + decimator.isaName() + ")";
+        runBench(name.c_str(), 1000000, CHANBUF_LEN, CHANBUF_LEN * sizeof(int32_t), [&](long i) {
+            struct timeval tv = {1600000000 + i / 25, (i % 25) * 40000}, outTv;
+            decimator.process(blocks[i % BENCH_PACKETS].ch[0], CHANBUF_LEN, &tv, meanBuf, &outTv);
+        });
+    }
+
+    std::vector<uint8_t> deltaBuf(CHANBUF_LEN * 5);
+    runBench("delta encode", 5000000, CHANBUF_LEN, CHANBUF_LEN * sizeof(int32_t), [&](long i) {
+        deltaEncode(blocks[i % BENCH_PACKETS].ch[i % NUM_CHANNELS], CHANBUF_LEN, 8, deltaBuf.data());
+    });
+    size_t deltaLen = deltaEncode(blocks[0].ch[0], CHANBUF_LEN, 8, deltaBuf.data());
+    runBench("delta decode", 5000000, CHANBUF_LEN, CHANBUF_LEN * sizeof(int32_t), [&](long) {
+        deltaDecode(deltaBuf.data(), deltaLen, CHANBUF_LEN, 8, meanBuf);
+    });
+
+    TextEncoder encoder;
+    encoder.setTiming(800, 0, 3);
+    runBench("text encode", 500000, CHANBUF_LEN, CHANBUF_LEN * sizeof(int32_t), [&](long i) {
+        struct timeval tv = {1600000000 + i / 25, (i % 25) * 40000};
+        encoder.encode(blocks[i % BENCH_PACKETS].ch[i % NUM_CHANNELS], CHANBUF_LEN, &tv);
+    });
+
+    // Отсчеты графика: добавление блока в историю с огибающей и минимум/максимум видимого окна
+    ChartBuffer chart(1440000, 16);
+    chart.setWindow(800 * 16);
+    static float chartBlocks[BENCH_PACKETS][CHANBUF_LEN];
+    for (int n = 0; n < BENCH_PACKETS; n++) {
+        decoder.decode(&packets[n * DATABUF_LEN], blocks[n].ch, voltsF);
+        memcpy(chartBlocks[n], voltsF[0], sizeof(chartBlocks[n]));
+    }
+    volatile double chartRange;
+    runBench("chart push+min/max", 1000000, CHANBUF_LEN, CHANBUF_LEN * sizeof(float), [&](long i) {
+        chart.push(chartBlocks[i % BENCH_PACKETS], CHANBUF_LEN);
+        chartRange = chart.windowMax() - chart.windowMin();
+    });
+    (void)chartRange;
+
+    // Спектр: отрезок по умолчанию (1024 отсчета) одного канала
+    RealFft fft(1024);
+    std::vector<float> fftFrame(fft.length()), fftPower(fft.length() / 2 + 1);
+    for (size_t i = 0; i < fftFrame.size(); i++) {
+        fftFrame[i] = chartBlocks[i / CHANBUF_LEN % BENCH_PACKETS][i % CHANBUF_LEN];
+    }
+    printf("FFT: %s\n", fft.isaName());
+    runBench("real FFT 1024 power", 200000, fft.length(), fft.length() * sizeof(float), [&](long) {
+        fft.power(fftFrame.data(), fftPower.data());
+    });
+
+    bool steimOk = checkSteim2(root + "/steim512", &logger, 512);
+    steimOk = checkSteim2(root + "/steim4096", &logger, 4096) && steimOk;
+
+    RotatingFile dirs(root, ".00", "data_ch0.dat", false, 5, &logger);
+    std::string existing = root + "/2020/09/13";
+    dirs.mkdirs(existing.c_str(), PATH_LEN, DIR_MODE);
+    runBench("mkdirs (existing)", 200000, 0, 0, [&](long) {
+        dirs.mkdirs(existing.c_str(), PATH_LEN, DIR_MODE);
+    });
+    runBench("mkdirs (new)", 2000, 0, 0, [&](long i) {
+        std::string path = root + "/mk/" + std::to_string(i) + "/a/b";
+        dirs.mkdirs(path.c_str(), PATH_LEN, DIR_MODE);
+    });
+
+    runWriterBench("writeData", root + "/bin", &logger, blocks, writerBlocks, 0, true, false);
+    runWriterBench("writeData (mean /4)", root + "/bin4", &logger, blocks, writerBlocks, 4, true, false);
+    runWriterBench("writeData (CIC+FIR /4)", root + "/cic4", &logger, blocks, writerBlocks, 4, true, false,
+                   BINARY_BLOCKS, DECIMATION_CIC_FIR);
+    runWriterBench("writeData (container)", root + "/cont", &logger, blocks, writerBlocks, 0, true, false,
+                   BINARY_CONTAINER);
+    runWriterBench("writeData (compressed)", root + "/comp", &logger, blocks, writerBlocks, 0, true, false,
+                   BINARY_COMPRESSED);
+    runWriterBench("writeData (miniSEED)", root + "/mseed", &logger, blocks, writerBlocks, 0, true, false,
+                   BINARY_MSEED);
+    runWriterBench("writeText", root + "/txt", &logger, blocks, writerBlocks, 0, false, true);
+    runWriterBench("writeData+writeText", root + "/all", &logger, blocks, writerBlocks, 0, true, true);
+    runWriterBench("fan-out (4 streams)", root + "/fan", &logger, blocks, writerBlocks, 0, true, false,
+                   BINARY_BLOCKS, DECIMATION_MEAN, "compressed/4, container/32, text/800");
+
+    fs::remove_all(root);
+    return steimOk ? 0 : 1;
+}
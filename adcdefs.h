@@ -0,0 +1,52 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_ADCDEFS_H
+#define ADCCOLLECTOR_ADCDEFS_H
+
+// Buffers length
+#define NUM_CHANNELS 4
+#define DATABUF_LEN  512
+#define CHANBUF_LEN  32
+// File names length
+#define FILE_LEN 256
+#define PATH_LEN 256
+
+enum errcodes {
+    SUCCESS = 0,
+    ADC_OPEN_ERROR = -1,
+    ADC_FAILURE = -2,
+    IO_FAILURE = -3,
+    ALL_CHANNELS_DISABLED = -4,
+    END_OF_DATA = -5
+};
+
+// Binary data formats
+enum binaryFormats {
+    BINARY_BLOCKS = 0,
+    BINARY_CONTAINER = 1,
+    BINARY_MSEED = 2,
+    BINARY_COMPRESSED = 3
+};
+
+// Filters used to reduce the sample rate (meaningDataBuffer)
+enum decimationFilters {
+    DECIMATION_MEAN = 0,
+    DECIMATION_CIC_FIR = 1
+};
+
+#endif //ADCCOLLECTOR_ADCDEFS_H
@@ -0,0 +1,109 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_ADCDEVICE_H
+#define ADCCOLLECTOR_ADCDEVICE_H
+#include <cstdint>
+#include <sys/time.h>
+
+/**
+ * Источники данных АЦП.
+ */
+enum deviceTypes {
+    DEVICE_USB = 0,
+    DEVICE_SIM = 1,
+    DEVICE_SIM_FAST = 2,
+    DEVICE_REPLAY = 3,
+    DEVICE_REPLAY_FAST = 4
+};
+
+/**
+ * Счетчики чтения данных с устройства.
+ */
+struct DeviceStats {
+    uint64_t completed;
+    uint64_t shortTransfers;
+    uint64_t timeouts;
+    uint64_t late;
+    uint64_t dropped;
+    uint64_t errors;
+};
+
+/**
+ * Устройство, поставляющее пакеты в формате ЛА-И24USB
+ * (DATABUF_LEN байт, слова по 4 байта: номер канала в старшей тетраде
+ * первого байта и 24-битный отсчет).
+ */
+class AdcDevice {
+public:
+    virtual ~AdcDevice() {}
+
+    /**
+     * Открытие устройства.
+     * @return - код ошибки.
+     */
+    virtual int8_t open() = 0;
+
+    /**
+     * Запуск преобразования и чтения.
+     * @param frequency - частота дискретизации (Гц).
+     * @param transferSize - размер одного запроса (байт, кратен DATABUF_LEN).
+     * @param timeout - таймаут одного запроса (msec).
+     * @param interval - ожидаемый интервал между запросами (msec).
+     * @return - код ошибки.
+     */
+    virtual int8_t start(int frequency, int transferSize, uint32_t timeout, uint32_t interval) = 0;
+
+    /**
+     * Получение очередного принятого буфера.
+     * @param buf - выходной буфер (не меньше размера запроса).
+     * @param len - число принятых байт.
+     * @param tv - время приема (относится к последнему отсчету буфера).
+     * @param timeout - время ожидания (msec).
+     * @return - код ошибки, END_OF_DATA, если данные закончились.
+     */
+    virtual int8_t read(uint8_t *buf, int *len, struct timeval *tv, uint32_t timeout) = 0;
+
+    /**
+     * Остановка чтения и преобразования.
+     * @return - код ошибки.
+     */
+    virtual int8_t stop() = 0;
+
+    /**
+     * Закрытие устройства.
+     */
+    virtual void close() = 0;
+
+    /**
+     * @return - произошла ли неисправимая ошибка чтения.
+     */
+    virtual bool failed() = 0;
+
+    /**
+     * @return - счетчики чтения.
+     */
+    virtual DeviceStats getStats() = 0;
+
+    /**
+     * @return - название устройства.
+     */
+    virtual const char *name() = 0;
+};
+
+
+#endif //ADCCOLLECTOR_ADCDEVICE_H
@@ -0,0 +1,412 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "adcdefs.h"
+#include "archivereader.h"
+#include "pyramid.h"
+#include "packetdecoder.h"
+
+// Output buffer size
+#define OUT_BUF_LEN (1 << 20)
+// Length of "YYYY-MM-DD HH:MM:SS.ffffff"
+#define TIME_TEXT_LEN 26
+// Max length of one output row
+#define ROW_LEN (TIME_TEXT_LEN + NUM_CHANNELS * 16)
+
+// Output formats
+enum dumpFormats {
+    DUMP_BINARY,
+    DUMP_CSV,
+    DUMP_VOLTS
+};
+
+/**
+ * Вывод справки.
+ * @param name - имя программы.
+ */
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s -d <data root> -s <start> -e <end> [options]\n"
+            "Extracts a time range of ADCCollector binary data (blocks or containers).\n"
+            "  -s, -e TIME   range [start, end), \"YYYY-MM-DD HH:MM:SS[.ffffff]\" UTC or epoch seconds\n"
+            "  -c LIST       channels, e.g. 0,2 (default: all)\n"
+            "  -f FORMAT     csv (raw samples), volts (csv in volts) or binary (default: csv)\n"
+            "                binary frame: int64 usec, int32 sample per channel, 0xffffffff if absent\n"
+            "  -r RATE       sample rate of block files after averaging (default: estimated)\n"
+            "  -p SECONDS    print min/max/mean overview with 1, 10, 60 or 600 s buckets (csv or volts)\n"
+            "  -1            data were written to one file per channel\n"
+            "  -o FILE       output file (default: stdout)\n",
+            name);
+}
+
+/**
+ * Разбор времени.
+ * @param text - время в виде "YYYY-MM-DD HH:MM:SS[.ffffff]" (UTC) или секунды от начала эпохи.
+ * @param usec - время в мкс.
+ * @return - удалось ли разобрать время.
+ */
+static bool parseTime(const char *text, int64_t *usec) {
+    struct tm gt {};
+    double sec;
+    char sep;
+    if (sscanf(text, "%d-%d-%d%c%d:%d:%lf", &gt.tm_year, &gt.tm_mon, &gt.tm_mday, &sep, &gt.tm_hour,
+               &gt.tm_min, &sec) == 7 && (sep == ' ' || sep == 'T') && sec >= 0 && sec < 61) {
+        gt.tm_year -= 1900;
+        gt.tm_mon -= 1;
+        gt.tm_sec = (int)sec;
+        *usec = (int64_t)timegm(&gt) * 1000000 + llround((sec - gt.tm_sec) * 1e6);
+        return true;
+    }
+    char *end;
+    sec = strtod(text, &end);
+    if (end != text && *end == '\0') {
+        *usec = llround(sec * 1e6);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Разбор списка каналов.
+ * @param text - номера каналов через запятую.
+ * @param channels - номера каналов.
+ * @return - удалось ли разобрать список.
+ */
+static bool parseChannels(const char *text, std::vector<uint8_t> *channels) {
+    channels->clear();
+    const char *p = text;
+    while (*p) {
+        char *end;
+        long chan = strtol(p, &end, 10);
+        if (end == p || chan < 0 || chan >= NUM_CHANNELS) {
+            return false;
+        }
+        channels->push_back((uint8_t)chan);
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return false;
+        }
+    }
+    return !channels->empty();
+}
+
+/**
+ * Запись целого числа в виде текста.
+ * @param p - буфер.
+ * @param value - число.
+ * @param width - минимальное число цифр (дополняется нулями).
+ * @return - позиция после числа.
+ */
+static char *putInt(char *p, int64_t value, int width = 1) {
+    if (value < 0) {
+        *p++ = '-';
+        value = -value;
+    }
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (n < width) {
+        digits[n++] = '0';
+    }
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+/**
+ * Вывод кадров в текстовом виде. Дата и время до секунд формируются
+ * один раз в секунду.
+ * @param reader - чтение архива.
+ * @param out - выходной файл.
+ * @param volts - выводить отсчеты в вольтах.
+ * @param frames - число выведенных кадров.
+ * @return - код ошибки.
+ */
+static int8_t dumpText(ArchiveReader *reader, FILE *out, bool volts, uint64_t *frames) {
+    std::vector<char> buf(OUT_BUF_LEN);
+    std::vector<int32_t> values(reader->channels());
+    size_t used = 0;
+    time_t cachedSec = -1;
+    char prefix[TIME_TEXT_LEN + 1];
+    int64_t usec;
+    int8_t res;
+    while ((res = reader->next(&usec, values.data())) == SUCCESS) {
+        time_t sec = (time_t)(usec / 1000000);
+        if (sec != cachedSec) {
+            struct tm gt;
+            gmtime_r(&sec, &gt);
+            strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S.", &gt);
+            cachedSec = sec;
+        }
+        char *p = buf.data() + used;
+        memcpy(p, prefix, TIME_TEXT_LEN - 6);
+        p = putInt(p + TIME_TEXT_LEN - 6, usec % 1000000, 6);
+        for (int32_t v : values) {
+            *p++ = ',';
+            if (v == NO_SAMPLE) {
+                continue;
+            }
+            if (!volts) {
+                p = putInt(p, v);
+                continue;
+            }
+            int64_t nanovolts = llround(v * VOLTS_SCALE * 1e9);
+            if (nanovolts < 0) {
+                *p++ = '-';
+                nanovolts = -nanovolts;
+            }
+            p = putInt(p, nanovolts / 1000000000);
+            *p++ = '.';
+            p = putInt(p, nanovolts % 1000000000, 9);
+        }
+        *p++ = '\n';
+        used = p - buf.data();
+        (*frames)++;
+        if (used + ROW_LEN > buf.size()) {
+            if (fwrite(buf.data(), 1, used, out) != used) {
+                return IO_FAILURE;
+            }
+            used = 0;
+        }
+    }
+    if (res != END_OF_DATA || fwrite(buf.data(), 1, used, out) != used) {
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Вывод обзора из файлов пирамиды: по строке на интервал, в котором
+ * есть данные хотя бы одного канала.
+ * @param root - каталог данных.
+ * @param channels - номера каналов.
+ * @param level - уровень пирамиды.
+ * @param from - начало интервала (мкс).
+ * @param to - конец интервала (мкс, не включается).
+ * @param out - выходной файл.
+ * @param volts - выводить значения в вольтах.
+ * @param frames - число выведенных строк.
+ * @return - код ошибки.
+ */
+static int8_t dumpPyramid(const std::string &root, const std::vector<uint8_t> &channels, int level,
+                          int64_t from, int64_t to, FILE *out, bool volts, uint64_t *frames) {
+    static const uint32_t bucketSec[PYRAMID_LEVELS] = PYRAMID_BUCKETS_SEC;
+    int64_t bucketUsec = (int64_t)bucketSec[level] * 1000000;
+    std::vector<std::vector<PyramidBucket>> buckets(channels.size());
+    PyramidReader reader;
+    for (time_t hour = from / 1000000 - from / 1000000 % 3600; (int64_t)hour * 1000000 < to; hour += 3600) {
+        int64_t hourUsec = (int64_t)hour * 1000000;
+        size_t first = from > hourUsec ? (from - hourUsec) / bucketUsec : 0;
+        size_t count = (to - hourUsec + bucketUsec - 1) / bucketUsec - first;
+        for (size_t c = 0; c < channels.size(); c++) {
+            if (reader.open(pyramidPath(root, hour, channels[c])) != SUCCESS ||
+                reader.read(level, first, count, &buckets[c]) != SUCCESS) {
+                buckets[c].clear();
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            bool any = false;
+            for (const std::vector<PyramidBucket> &b : buckets) {
+                any = any || (i < b.size() && b[i].count > 0);
+            }
+            if (!any) {
+                continue;
+            }
+            time_t sec = hour + (first + i) * bucketSec[level];
+            struct tm gt;
+            gmtime_r(&sec, &gt);
+            char prefix[TIME_TEXT_LEN + 1];
+            strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &gt);
+            fputs(prefix, out);
+            for (const std::vector<PyramidBucket> &b : buckets) {
+                if (i >= b.size() || b[i].count == 0) {
+                    fputs(",,,,0", out);
+                } else if (volts) {
+                    fprintf(out, ",%.9f,%.9f,%.9f,%u", b[i].min * VOLTS_SCALE, b[i].max * VOLTS_SCALE,
+                            (double)b[i].sum / b[i].count * VOLTS_SCALE, b[i].count);
+                } else {
+                    fprintf(out, ",%d,%d,%.1f,%u", b[i].min, b[i].max, (double)b[i].sum / b[i].count,
+                            b[i].count);
+                }
+            }
+            fputc('\n', out);
+            (*frames)++;
+        }
+    }
+    return ferror(out) ? IO_FAILURE : SUCCESS;
+}
+
+/**
+ * Вывод кадров в двоичном виде: время в мкс (int64), затем по отсчету (int32)
+ * на каждый канал.
+ * @param reader - чтение архива.
+ * @param out - выходной файл.
+ * @param frames - число выведенных кадров.
+ * @return - код ошибки.
+ */
+static int8_t dumpBinary(ArchiveReader *reader, FILE *out, uint64_t *frames) {
+    size_t frameLen = sizeof(int64_t) + reader->channels() * sizeof(int32_t);
+    std::vector<uint8_t> buf(OUT_BUF_LEN - OUT_BUF_LEN % frameLen);
+    size_t used = 0;
+    int64_t usec;
+    int8_t res;
+    while ((res = reader->next(&usec, (int32_t *)(buf.data() + used + sizeof(int64_t)))) == SUCCESS) {
+        memcpy(buf.data() + used, &usec, sizeof(usec));
+        used += frameLen;
+        (*frames)++;
+        if (used == buf.size()) {
+            if (fwrite(buf.data(), 1, used, out) != used) {
+                return IO_FAILURE;
+            }
+            used = 0;
+        }
+    }
+    if (res != END_OF_DATA || fwrite(buf.data(), 1, used, out) != used) {
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    std::string root, outName;
+    int64_t from = 0, to = 0;
+    bool haveFrom = false, haveTo = false, oneFile = false;
+    double rate = 0;
+    int format = DUMP_CSV;
+    int level = -1;
+    std::vector<uint8_t> channels;
+    for (uint8_t i = 0; i < NUM_CHANNELS; i++) {
+        channels.push_back(i);
+    }
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:s:e:c:f:r:p:o:1h")) != -1) {
+        switch (opt) {
+            case 'd':
+                root = optarg;
+                break;
+            case 's':
+                haveFrom = parseTime(optarg, &from);
+                break;
+            case 'e':
+                haveTo = parseTime(optarg, &to);
+                break;
+            case 'c':
+                if (!parseChannels(optarg, &channels)) {
+                    fprintf(stderr, "Bad channel list: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'f':
+                if (strcmp(optarg, "binary") == 0) {
+                    format = DUMP_BINARY;
+                } else if (strcmp(optarg, "csv") == 0) {
+                    format = DUMP_CSV;
+                } else if (strcmp(optarg, "volts") == 0) {
+                    format = DUMP_VOLTS;
+                } else {
+                    fprintf(stderr, "Unknown format: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r':
+                rate = atof(optarg);
+                break;
+            case 'p': {
+                static const uint32_t bucketSec[PYRAMID_LEVELS] = PYRAMID_BUCKETS_SEC;
+                for (int l = 0; l < PYRAMID_LEVELS; l++) {
+                    if ((uint32_t)atoi(optarg) == bucketSec[l]) {
+                        level = l;
+                    }
+                }
+                if (level < 0) {
+                    fprintf(stderr, "No overview with %s s buckets\n", optarg);
+                    return 1;
+                }
+                break;
+            }
+            case 'o':
+                outName = optarg;
+                break;
+            case '1':
+                oneFile = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (root.empty() || !haveFrom || !haveTo || to <= from || rate < 0 || (level >= 0 && format == DUMP_BINARY)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (!outName.empty()) {
+        out = fopen(outName.c_str(), format == DUMP_BINARY ? "wb" : "w");
+        if (out == NULL) {
+            fprintf(stderr, "Cannot open output file %s\n", outName.c_str());
+            return 1;
+        }
+    }
+
+    ArchiveReader reader(root, channels, oneFile, rate);
+    reader.open(from, to);
+    uint64_t frames = 0;
+    int8_t res;
+    if (level >= 0) {
+        std::string header = "time";
+        for (uint8_t chan : channels) {
+            std::string ch = ",ch" + std::to_string(chan);
+            header += ch + "_min" + ch + "_max" + ch + "_mean" + ch + "_count";
+        }
+        header += "\n";
+        fputs(header.c_str(), out);
+        res = dumpPyramid(root, channels, level, from, to, out, format == DUMP_VOLTS, &frames);
+    } else if (format == DUMP_BINARY) {
+        res = dumpBinary(&reader, out, &frames);
+    } else {
+        std::string header = "time";
+        for (uint8_t chan : channels) {
+            header += ",ch" + std::to_string(chan);
+        }
+        header += "\n";
+        fputs(header.c_str(), out);
+        res = dumpText(&reader, out, format == DUMP_VOLTS, &frames);
+    }
+    if (fclose(out) != 0) {
+        res = IO_FAILURE;
+    }
+    fprintf(stderr, "%llu frames\n", (unsigned long long)frames);
+    if (res != SUCCESS) {
+        fprintf(stderr, "Extraction failed: read or write error (for block files without a rate use -r)\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,439 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archivereader.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Blocks used to estimate the sample step of a binary file
+#define STEP_ESTIMATE_BLOCKS 256
+
+/**
+ * Конструктор чтения двоичного файла.
+ */
+BlockFileReader::BlockFileReader() = default;
+
+/**
+ * Деструктор. Освобождает отображение файла.
+ */
+BlockFileReader::~BlockFileReader() {
+    close();
+}
+
+/**
+ * Отображение файла в память.
+ * @param fileName - имя файла.
+ * @return - код ошибки.
+ */
+int8_t BlockFileReader::open(const std::string &fileName) {
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return IO_FAILURE;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)BLOCK_HEADER_LEN) {
+        ::close(fd);
+        return IO_FAILURE;
+    }
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return IO_FAILURE;
+    }
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    map = (const uint8_t *)addr;
+    // Недописанный последний отсчет отбрасывается
+    mapLen = st.st_size & ~(size_t)3;
+    return SUCCESS;
+}
+
+/**
+ * Освобождение отображения файла.
+ */
+void BlockFileReader::close() {
+    if (map != nullptr) {
+        munmap((void *)map, mapLen);
+        map = nullptr;
+        mapLen = 0;
+    }
+}
+
+/**
+ * Поиск блока, содержащего заданное время.
+ * @param usec - время (мкс от начала эпохи).
+ * @return - смещение последнего блока, начинающегося не позже usec
+ * (первого блока, если таких нет).
+ */
+size_t BlockFileReader::seek(int64_t usec) {
+    size_t lo = findMarker(0);
+    if (lo >= mapLen || blockTime(lo) > usec) {
+        return lo;
+    }
+    // В [lo, hi) блок lo начинается не позже usec, блоки с hi и дальше - позже
+    size_t hi = mapLen;
+    while (findMarker(lo + 4) < hi) {
+        size_t mid = (lo + (hi - lo) / 2) & ~(size_t)3;
+        size_t m = findMarker(mid > lo ? mid : lo + 4);
+        if (m >= hi) {
+            hi = mid;
+        } else if (blockTime(m) > usec) {
+            hi = m;
+        } else {
+            lo = m;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Разбор блока.
+ * @param offset - смещение блока.
+ * @param usec - время первого отсчета.
+ * @param data - отсчеты блока (в отображенном файле).
+ * @param len - число отсчетов.
+ * @param next - смещение следующего блока.
+ * @return - есть ли блок по этому смещению.
+ */
+bool BlockFileReader::block(size_t offset, int64_t *usec, const int32_t **data, size_t *len, size_t *next) {
+    if (offset >= mapLen || !isMarker(offset)) {
+        return false;
+    }
+    *next = findMarker(offset + BLOCK_HEADER_LEN);
+    *usec = blockTime(offset);
+    *data = (const int32_t *)(map + offset + BLOCK_HEADER_LEN);
+    *len = (*next - offset - BLOCK_HEADER_LEN) / sizeof(int32_t);
+    return true;
+}
+
+/**
+ * Оценка шага отсчетов по первым блокам файла, когда частота неизвестна.
+ * @return - шаг в мкс (0, если в файле меньше двух блоков).
+ */
+double BlockFileReader::estimateStep() {
+    size_t offset = findMarker(0), next, len;
+    int64_t first = 0, last = 0, usec;
+    const int32_t *data;
+    size_t samples = 0, before = 0;
+    for (int i = 0; i < STEP_ESTIMATE_BLOCKS && block(offset, &usec, &data, &len, &next); i++) {
+        if (i == 0) {
+            first = usec;
+        }
+        last = usec;
+        before = samples;
+        samples += len;
+        offset = next;
+    }
+    return before > 0 && last > first ? (double)(last - first) / before : 0;
+}
+
+/**
+ * Поиск маркера блока.
+ * @param offset - смещение, с которого начинается поиск.
+ * @return - смещение маркера (длина файла, если маркера нет).
+ */
+size_t BlockFileReader::findMarker(size_t offset) {
+    offset = (offset + 3) & ~(size_t)3;
+    while (offset + BLOCK_HEADER_LEN <= mapLen) {
+        if (isMarker(offset)) {
+            return offset;
+        }
+        offset += 4;
+    }
+    return mapLen;
+}
+
+/**
+ * Проверка маркера блока. Два слова 0xFFFFFFFF подряд встречаются только
+ * как маркер и младшая половина времени, поэтому второе из них не маркер.
+ * @param offset - смещение.
+ * @return - начинается ли блок по этому смещению.
+ */
+bool BlockFileReader::isMarker(size_t offset) {
+    uint32_t word;
+    memcpy(&word, map + offset, sizeof(word));
+    if (word != BLOCK_MARKER) {
+        return false;
+    }
+    if (offset == 0) {
+        return true;
+    }
+    memcpy(&word, map + offset - 4, sizeof(word));
+    return word != BLOCK_MARKER;
+}
+
+/**
+ * @param offset - смещение блока.
+ * @return - время блока в мкс.
+ */
+int64_t BlockFileReader::blockTime(size_t offset) {
+    uint64_t msec;
+    memcpy(&msec, map + offset + 4, sizeof(msec));
+    return (int64_t)msec * 1000;
+}
+
+/**
+ * Конструктор чтения канала архива.
+ * @param root - каталог данных.
+ * @param channel - номер канала.
+ * @param oneFile - данные записаны в один файл, а не по часам.
+ * @param rate - частота отсчетов в двоичных файлах после усреднения
+ * (0 - оценивать по времени блоков).
+ */
+ChannelArchive::ChannelArchive(std::string root, uint8_t channel, bool oneFile, double rate) {
+    dataRoot = root;
+    chan = channel;
+    dataInOneFile = oneFile;
+    sampleRate = rate;
+}
+
+/**
+ * Установка интервала чтения.
+ * @param fromUsec - начало интервала (мкс от начала эпохи).
+ * @param toUsec - конец интервала (не включается).
+ * @return - код ошибки.
+ */
+int8_t ChannelArchive::seek(int64_t fromUsec, int64_t toUsec) {
+    from = fromUsec;
+    to = toUsec;
+    blocks.close();
+    container.close();
+    fileOpen = false;
+    if (dataInOneFile) {
+        hour = lastHour = 0;
+        return SUCCESS;
+    }
+    // Блок, начавшийся в предыдущем часе, может содержать начало интервала
+    hour = (time_t)(from / 1000000 - CONTAINER_MAX_CHUNK_SPAN);
+    hour -= hour % 3600;
+    lastHour = (time_t)((to - 1) / 1000000);
+    lastHour -= lastHour % 3600;
+    return SUCCESS;
+}
+
+/**
+ * Чтение следующего участка отсчетов.
+ * @param span - участок отсчетов, действителен до следующего вызова.
+ * @return - код ошибки (END_OF_DATA после конца интервала).
+ */
+int8_t ChannelArchive::next(SampleSpan *span) {
+    while (true) {
+        if (!fileOpen) {
+            int8_t res = openHour();
+            if (res != SUCCESS) {
+                return res;
+            }
+        }
+        int64_t usec;
+        if (!isContainer) {
+            size_t nextBlock;
+            if (!blocks.block(position, &usec, &span->data, &span->len, &nextBlock)) {
+                blocks.close();
+                fileOpen = false;
+                continue;
+            }
+            position = nextBlock;
+        } else {
+            if (position >= container.chunks()) {
+                container.close();
+                fileOpen = false;
+                continue;
+            }
+            // Поврежденные блоки контейнера пропускаются
+            if (container.readChunk(position++, &chunkData, &usec) != SUCCESS) {
+                continue;
+            }
+            span->data = chunkData.data();
+            span->len = chunkData.size();
+        }
+        if (usec >= to) {
+            return END_OF_DATA;
+        }
+        span->startUsec = usec;
+        span->stepUsec = fileStep;
+        return SUCCESS;
+    }
+}
+
+/**
+ * Открытие очередного существующего файла интервала.
+ * @return - код ошибки (END_OF_DATA, если файлов больше нет,
+ * IO_FAILURE, если частоту отсчетов двоичного файла не удалось определить).
+ */
+int8_t ChannelArchive::openHour() {
+    while (hour <= lastHour) {
+        char blockSuffix[FILE_LEN], containerSuffix[FILE_LEN];
+        std::string prefix;
+        if (dataInOneFile) {
+            snprintf(blockSuffix, FILE_LEN, "data_ch%d.dat", chan);
+            snprintf(containerSuffix, FILE_LEN, "data_ch%d.adc", chan);
+            prefix = dataRoot + "/";
+        } else {
+            struct tm gt;
+            gmtime_r(&hour, &gt);
+            char hourPath[PATH_LEN];
+            snprintf(hourPath, PATH_LEN, "/%04d/%02d/%02d/%04d%02d%02d_%02d", gt.tm_year + 1900, gt.tm_mon + 1,
+                     gt.tm_mday, gt.tm_year + 1900, gt.tm_mon + 1, gt.tm_mday, gt.tm_hour);
+            snprintf(blockSuffix, FILE_LEN, ".%02d", chan);
+            snprintf(containerSuffix, FILE_LEN, "_%02d.adc", chan);
+            prefix = dataRoot + hourPath;
+        }
+        hour += 3600;
+
+        if (blocks.open(prefix + blockSuffix) == SUCCESS) {
+            double step = sampleRate > 0 ? 1e6 / sampleRate : blocks.estimateStep();
+            if (step > 0) {
+                fileStep = step;
+            } else if (fileStep == 0) {
+                blocks.close();
+                return IO_FAILURE;
+            }
+            isContainer = false;
+            position = blocks.seek(from);
+            fileOpen = true;
+            return SUCCESS;
+        }
+        if (container.open(prefix + containerSuffix) == SUCCESS && container.header().sampleRate > 0) {
+            fileStep = 1e6 / container.header().sampleRate;
+            isContainer = true;
+            position = container.seek(from);
+            fileOpen = true;
+            return SUCCESS;
+        }
+    }
+    return END_OF_DATA;
+}
+
+/**
+ * Конструктор чтения архива.
+ * @param root - каталог данных.
+ * @param channels - номера читаемых каналов.
+ * @param oneFile - данные записаны в один файл, а не по часам.
+ * @param rate - частота отсчетов в двоичных файлах после усреднения (0 - оценивать).
+ */
+ArchiveReader::ArchiveReader(std::string root, const std::vector<uint8_t> &channels, bool oneFile, double rate) {
+    cursors.resize(channels.size());
+    for (size_t i = 0; i < channels.size(); i++) {
+        cursors[i].archive.reset(new ChannelArchive(root, channels[i], oneFile, rate));
+    }
+}
+
+/**
+ * Установка интервала чтения.
+ * @param fromUsec - начало интервала (мкс от начала эпохи).
+ * @param toUsec - конец интервала (не включается).
+ * @return - код ошибки.
+ */
+int8_t ArchiveReader::open(int64_t fromUsec, int64_t toUsec) {
+    from = fromUsec;
+    to = toUsec;
+    for (Cursor &c : cursors) {
+        c.span = SampleSpan {};
+        c.pos = 0;
+        c.ended = false;
+        if (c.archive->seek(from, to) != SUCCESS) {
+            return IO_FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Чтение следующего кадра.
+ * @param usec - время кадра.
+ * @param values - отсчеты каналов (NO_SAMPLE, если у канала нет отсчета в это время).
+ * @return - код ошибки (END_OF_DATA после конца интервала).
+ */
+int8_t ArchiveReader::next(int64_t *usec, int32_t *values) {
+    int64_t first = INT64_MAX;
+    double step = 0;
+    for (Cursor &c : cursors) {
+        if (c.ended) {
+            continue;
+        }
+        int8_t res = fill(&c);
+        if (res != SUCCESS) {
+            return res;
+        }
+        if (!c.ended && c.time < first) {
+            first = c.time;
+            step = c.span.stepUsec;
+        }
+    }
+    if (first == INT64_MAX) {
+        return END_OF_DATA;
+    }
+    for (size_t i = 0; i < cursors.size(); i++) {
+        Cursor &c = cursors[i];
+        if (!c.ended && c.time - first < step / 2) {
+            values[i] = c.span.data[c.pos++];
+        } else {
+            values[i] = NO_SAMPLE;
+        }
+    }
+    *usec = first;
+    return SUCCESS;
+}
+
+/**
+ * @return - число читаемых каналов.
+ */
+size_t ArchiveReader::channels() {
+    return cursors.size();
+}
+
+/**
+ * Переход к первому отсчету канала внутри интервала и расчет его времени.
+ * @param c - положение чтения канала.
+ * @return - код ошибки.
+ */
+int8_t ArchiveReader::fill(Cursor *c) {
+    while (true) {
+        if (c->pos < c->span.len) {
+            c->time = sampleTime(*c);
+            if (c->time >= to) {
+                c->ended = true;
+                return SUCCESS;
+            }
+            if (c->time >= from) {
+                return SUCCESS;
+            }
+            c->pos++;
+            continue;
+        }
+        int8_t res = c->archive->next(&c->span);
+        c->pos = 0;
+        if (res == END_OF_DATA) {
+            c->ended = true;
+            return SUCCESS;
+        }
+        if (res != SUCCESS) {
+            return res;
+        }
+    }
+}
+
+/**
+ * @param c - положение чтения канала.
+ * @return - время текущего отсчета канала.
+ */
+int64_t ArchiveReader::sampleTime(const Cursor &c) {
+    return c.span.startUsec + (int64_t)(c.pos * c.span.stepUsec + 0.5);
+}
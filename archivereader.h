@@ -0,0 +1,139 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_ARCHIVEREADER_H
+#define ADCCOLLECTOR_ARCHIVEREADER_H
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+#include "adcdefs.h"
+#include "container.h"
+
+// Marker that starts every block of a binary data file
+#define BLOCK_MARKER 0xffffffffu
+// Marker and millisecond timestamp before block samples
+#define BLOCK_HEADER_LEN (4 + sizeof(uint64_t))
+// Value of a channel without a sample at the frame time (never a valid sample)
+#define NO_SAMPLE ((int32_t)0xffffffff)
+
+/**
+ * Участок отсчетов канала, идущих с постоянным шагом.
+ */
+struct SampleSpan {
+    int64_t startUsec;
+    double stepUsec;
+    const int32_t *data;
+    size_t len;
+};
+
+/**
+ * Чтение двоичного файла данных (блоки 0xFFFFFFFF, время в мс, отсчеты int32)
+ * через отображение файла в память. Отсчеты никогда не равны 0xFFFFFFFF
+ * (младший байт всегда нулевой), поэтому граница блока - следующий маркер.
+ * Поиск по времени - двоичный по смещению в файле с подстройкой к маркеру.
+ */
+class BlockFileReader {
+public:
+    BlockFileReader();
+    ~BlockFileReader();
+
+    int8_t open(const std::string &fileName);
+    void close();
+    size_t seek(int64_t usec);
+    bool block(size_t offset, int64_t *usec, const int32_t **data, size_t *len, size_t *next);
+    double estimateStep();
+
+private:
+    const uint8_t *map = nullptr;
+    size_t mapLen = 0;
+
+    size_t findMarker(size_t offset);
+    bool isMarker(size_t offset);
+    int64_t blockTime(size_t offset);
+};
+
+/**
+ * Последовательное чтение отсчетов одного канала из часовых файлов архива
+ * начиная с заданного времени. Для каждого часа используется двоичный файл
+ * YYYYMMDD_HH.CC, а если его нет - контейнер YYYYMMDD_HH_CC.adc.
+ */
+class ChannelArchive {
+public:
+    ChannelArchive(std::string root, uint8_t channel, bool oneFile, double rate);
+
+    int8_t seek(int64_t fromUsec, int64_t toUsec);
+    int8_t next(SampleSpan *span);
+
+private:
+    std::string dataRoot;
+    uint8_t chan;
+    bool dataInOneFile;
+    double sampleRate;
+    double fileStep = 0;
+    int64_t from = 0;
+    int64_t to = 0;
+    time_t hour = 0;
+    time_t lastHour = 0;
+
+    BlockFileReader blocks;
+    ContainerReader container;
+    bool fileOpen = false;
+    bool isContainer = false;
+    size_t position = 0;
+    std::vector<int32_t> chunkData;
+
+    int8_t openHour();
+};
+
+/**
+ * Чтение нескольких каналов архива за интервал времени покадрово:
+ * кадр - время и по одному отсчету каждого канала. Отсчеты каналов
+ * сопоставляются по времени с точностью до половины шага.
+ */
+class ArchiveReader {
+public:
+    ArchiveReader(std::string root, const std::vector<uint8_t> &channels, bool oneFile, double rate);
+
+    int8_t open(int64_t fromUsec, int64_t toUsec);
+    int8_t next(int64_t *usec, int32_t *values);
+    size_t channels();
+
+private:
+    /**
+     * Текущее положение чтения одного канала.
+     */
+    struct Cursor {
+        std::unique_ptr<ChannelArchive> archive;
+        SampleSpan span {};
+        size_t pos = 0;
+        int64_t time = 0;
+        bool ended = false;
+    };
+
+    std::vector<Cursor> cursors;
+    int64_t from = 0;
+    int64_t to = 0;
+
+    int8_t fill(Cursor *c);
+    int64_t sampleTime(const Cursor &c);
+};
+
+
+#endif //ADCCOLLECTOR_ARCHIVEREADER_H
@@ -0,0 +1,227 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "capturefile.h"
+#include "adcdefs.h"
+#include "rotatingfile.h"
+#include <cstring>
+
+/**
+ * Запись 32-битного числа в порядке little-endian.
+ * @param p - выходной буфер.
+ * @param v - число.
+ */
+static void putU32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (v >> (8 * i)) & 0xff;
+    }
+}
+
+/**
+ * Чтение 32-битного числа в порядке little-endian.
+ * @param p - входной буфер.
+ * @return - число.
+ */
+static uint32_t getU32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Конструктор записи файла захвата.
+ * @param log - журнал.
+ */
+CaptureWriter::CaptureWriter(Logger *log) {
+    logger = log;
+}
+
+/**
+ * Деструктор. Закрывает файл.
+ */
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+/**
+ * Создание файла захвата и запись заголовка.
+ * @param name - имя файла.
+ * @param frequency - частота дискретизации (Гц).
+ * @param transferSize - размер запроса (байт).
+ * @return - код ошибки.
+ */
+int8_t CaptureWriter::open(const std::string &name, uint32_t frequency, uint32_t transferSize) {
+    close();
+    f = fopen(name.c_str(), "wb");
+    if (f == NULL) {
+        logger->logging(ERROR, "Cannot open a capture file for writing");
+        return IO_FAILURE;
+    }
+    buf.resize(FILE_BUF_LEN);
+    setvbuf(f, buf.data(), _IOFBF, buf.size());
+    fileName = name;
+    uint8_t header[CAPTURE_HEADER_LEN];
+    memcpy(header, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN);
+    putU32(header + CAPTURE_MAGIC_LEN, frequency);
+    putU32(header + CAPTURE_MAGIC_LEN + 4, transferSize);
+    if (fwrite(header, 1, CAPTURE_HEADER_LEN, f) != CAPTURE_HEADER_LEN) {
+        logger->logging(ERROR, "Cannot write capture file header");
+        close();
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Запись одного принятого запроса.
+ * @param data - принятые байты.
+ * @param len - их число.
+ * @param tv - время приема.
+ * @return - код ошибки.
+ */
+int8_t CaptureWriter::write(const uint8_t *data, uint32_t len, const struct timeval *tv) {
+    if (f == NULL) {
+        return IO_FAILURE;
+    }
+    uint8_t header[CAPTURE_RECORD_LEN];
+    uint64_t sec = (uint64_t)(int64_t)tv->tv_sec;
+    putU32(header, sec & 0xffffffff);
+    putU32(header + 4, sec >> 32);
+    putU32(header + 8, (uint32_t)tv->tv_usec);
+    putU32(header + 12, len);
+    if (fwrite(header, 1, CAPTURE_RECORD_LEN, f) != CAPTURE_RECORD_LEN || fwrite(data, 1, len, f) != len) {
+        logger->logging(ERROR, "Cannot write data to capture file");
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Закрытие файла захвата.
+ */
+void CaptureWriter::close() {
+    if (f != NULL) {
+        if (fclose(f) != 0) {
+            logger->logging(ERROR, "Cannot close capture file");
+        }
+        f = NULL;
+    }
+}
+
+/**
+ * @return - имя открытого файла.
+ */
+std::string CaptureWriter::path() {
+    return fileName;
+}
+
+/**
+ * Конструктор чтения файла захвата.
+ * @param log - журнал.
+ */
+CaptureReader::CaptureReader(Logger *log) {
+    logger = log;
+}
+
+/**
+ * Деструктор. Закрывает файл.
+ */
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+/**
+ * Открытие файла захвата и проверка заголовка.
+ * @param name - имя файла.
+ * @return - код ошибки.
+ */
+int8_t CaptureReader::open(const std::string &name) {
+    close();
+    f = fopen(name.c_str(), "rb");
+    if (f == NULL) {
+        logger->logging(ERROR, "Cannot open a capture file for reading");
+        return IO_FAILURE;
+    }
+    buf.resize(FILE_BUF_LEN);
+    setvbuf(f, buf.data(), _IOFBF, buf.size());
+    uint8_t header[CAPTURE_HEADER_LEN];
+    if (fread(header, 1, CAPTURE_HEADER_LEN, f) != CAPTURE_HEADER_LEN ||
+        memcmp(header, CAPTURE_MAGIC, CAPTURE_MAGIC_LEN) != 0) {
+        logger->logging(ERROR, "Not a capture file");
+        close();
+        return IO_FAILURE;
+    }
+    freq = getU32(header + CAPTURE_MAGIC_LEN);
+    size = getU32(header + CAPTURE_MAGIC_LEN + 4);
+    return SUCCESS;
+}
+
+/**
+ * Чтение очередного запроса.
+ * @param data - принятые байты.
+ * @param tv - время приема.
+ * @return - код ошибки, END_OF_DATA в конце файла.
+ */
+int8_t CaptureReader::next(std::vector<uint8_t> *data, struct timeval *tv) {
+    if (f == NULL) {
+        return IO_FAILURE;
+    }
+    uint8_t header[CAPTURE_RECORD_LEN];
+    size_t n = fread(header, 1, CAPTURE_RECORD_LEN, f);
+    if (n == 0 && feof(f)) {
+        return END_OF_DATA;
+    }
+    if (n != CAPTURE_RECORD_LEN) {
+        logger->logging(WARN, "Capture file is truncated");
+        return END_OF_DATA;
+    }
+    uint32_t len = getU32(header + 12);
+    if (len > CAPTURE_MAX_TRANSFER) {
+        logger->logging(ERROR, "Capture file is corrupted: wrong record length");
+        return IO_FAILURE;
+    }
+    tv->tv_sec = (time_t)(int64_t)((uint64_t)getU32(header) | ((uint64_t)getU32(header + 4) << 32));
+    tv->tv_usec = getU32(header + 8);
+    data->resize(len);
+    if (fread(data->data(), 1, len, f) != len) {
+        logger->logging(WARN, "Capture file is truncated");
+        return END_OF_DATA;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Закрытие файла захвата.
+ */
+void CaptureReader::close() {
+    if (f != NULL) {
+        fclose(f);
+        f = NULL;
+    }
+}
+
+/**
+ * @return - частота дискретизации при захвате (Гц).
+ */
+uint32_t CaptureReader::frequency() {
+    return freq;
+}
+
+/**
+ * @return - размер запроса при захвате (байт).
+ */
+uint32_t CaptureReader::transferSize() {
+    return size;
+}
@@ -0,0 +1,82 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_CAPTUREFILE_H
+#define ADCCOLLECTOR_CAPTUREFILE_H
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <sys/time.h>
+#include "logger.h"
+
+// Capture file signature
+#define CAPTURE_MAGIC "ADCRAW1\n"
+#define CAPTURE_MAGIC_LEN 8
+// Capture header: signature, frequency (uint32), transfer size (uint32)
+#define CAPTURE_HEADER_LEN (CAPTURE_MAGIC_LEN + 8)
+// Record header: seconds (int64), microseconds (int32), length (uint32)
+#define CAPTURE_RECORD_LEN 16
+// Largest transfer accepted from a capture file
+#define CAPTURE_MAX_TRANSFER (1 << 20)
+
+/**
+ * Запись принятых с АЦП запросов в файл захвата без разбора:
+ * заголовок (сигнатура, частота, размер запроса), затем для каждого
+ * запроса время приема, длина и сами байты в том виде, в каком они пришли.
+ */
+class CaptureWriter {
+public:
+    explicit CaptureWriter(Logger *log);
+    ~CaptureWriter();
+
+    int8_t open(const std::string &fileName, uint32_t frequency, uint32_t transferSize);
+    int8_t write(const uint8_t *data, uint32_t len, const struct timeval *tv);
+    void close();
+    std::string path();
+
+private:
+    Logger *logger;
+    FILE *f = NULL;
+    std::vector<char> buf;
+    std::string fileName;
+};
+
+/**
+ * Последовательное чтение файла захвата.
+ */
+class CaptureReader {
+public:
+    explicit CaptureReader(Logger *log);
+    ~CaptureReader();
+
+    int8_t open(const std::string &fileName);
+    int8_t next(std::vector<uint8_t> *data, struct timeval *tv);
+    void close();
+    uint32_t frequency();
+    uint32_t transferSize();
+
+private:
+    Logger *logger;
+    FILE *f = NULL;
+    std::vector<char> buf;
+    uint32_t freq = 0;
+    uint32_t size = 0;
+};
+
+
+#endif //ADCCOLLECTOR_CAPTUREFILE_H
@@ -24,9 +24,15 @@
 CentralWidget::CentralWidget(QWidget *parent) : QWidget(parent) {
     channels = new std::vector<ChartWidget*>;
     for(int i = 0; i < Settings::instance().getNumOfChannels(); i++) {
-        ChartWidget *channel = new ChartWidget(this);
+        ChartWidget *channel = new ChartWidget(i, this);
         channels->push_back(channel);
     }
+    dirty.resize(channels->size(), false);
+    frameTimer = new QTimer(this);
+    frameTimer->setSingleShot(true);
+    frameTimer->setTimerType(Qt::PreciseTimer);
+    connect(frameTimer, &QTimer::timeout, this, &CentralWidget::slotFrame);
+    lastFrame.start();
     reload();
     l = new QGridLayout(this);
     l->addWidget(channels->at(0), 0, 0);
@@ -60,6 +66,22 @@ void CentralWidget::reload() {
     for(int i = 0; i < Settings::instance().getNumOfChannels(); i++) {
         channels->at(i)->setSettings(Settings::instance().loadChannelSettings(i));
     }
+    GlobalView globalView = Settings::instance().loadGlobalSettings();
+    setMaxFps(globalView.maxFps);
+    spectrum.reset();
+    spectrum.reset(new SpectrumWorker(globalView.spectrumLength, globalView.spectrumOverlap, globalView.frequency));
+}
+
+/**
+ * Устанавливает наибольшую частоту кадров графиков. Она не превышает
+ * частоту обновления экрана.
+ * @param fps - кадров в секунду.
+ */
+void CentralWidget::setMaxFps(int fps) {
+    QScreen *screen = QGuiApplication::primaryScreen();
+    double refreshRate = screen != nullptr && screen->refreshRate() > 0 ? screen->refreshRate() : 60;
+    double rate = fps > 0 && fps < refreshRate ? fps : refreshRate;
+    frameInterval = (int)ceil(1000 / rate);
 }
 
 /**
@@ -74,11 +96,76 @@ void CentralWidget::clear() {
 }
 
 /**
- * Записывает данные полученные с АЦП во все каналы.
- * @param dataForChans - данные с АЦП.
+ * Записывает отсчеты, полученные с АЦП, во все каналы и передает их в расчет
+ * спектра для каналов в режимах спектра и водопада. Готовые спектры
+ * забираются здесь же.
+ * @param blocks - блоки отсчетов для отображения.
  */
-void CentralWidget::setDataForChannels(std::vector<double> dataForChans) {
-    for(int i = 0; i < dataForChans.size(); i++) {
-        channels->at(i)->addChartValue(dataForChans[i]);
+void CentralWidget::setDataForChannels(const std::vector<DisplayBlock> &blocks) {
+    if(blocks.empty()) {
+        return;
+    }
+    for(int i = 0; i < (int)channels->size() && i < NUM_CHANNELS; i++) {
+        for(const DisplayBlock &block : blocks) {
+            channels->at(i)->addChartValues(block.values[i], CHANBUF_LEN);
+        }
+        dirty[i] = true;
+    }
+
+    uint32_t mask = 0;
+    for(int i = 0; i < (int)channels->size() && i < NUM_CHANNELS; i++) {
+        int mode = channels->at(i)->displayMode();
+        if(mode == CHART_MODE_SPECTRUM || mode == CHART_MODE_WATERFALL) {
+            mask |= 1u << i;
+        }
+    }
+    spectrum->setChannels(mask);
+    if(mask != 0) {
+        // Очередь вмещает блоки самого длинного интервала обновления; если поток
+        // спектра все же не успевает, после пропуска расчет начинается заново
+        for(const DisplayBlock &block : blocks) {
+            spectrum->push(block.values);
+        }
+        for(int i = 0; i < (int)channels->size() && i < NUM_CHANNELS; i++) {
+            if(!(mask & (1u << i))) {
+                continue;
+            }
+            if(channels->at(i)->displayMode() == CHART_MODE_WATERFALL) {
+                bool gap;
+                size_t count = spectrum->takeFrames(i, &waterfallFrames, &gap);
+                channels->at(i)->addWaterfallFrames(waterfallFrames.data(), count, spectrum->bins(),
+                                                    spectrum->binWidth(), gap);
+            } else if(spectrum->takeSpectrum(i, &spectrumValues)) {
+                channels->at(i)->setSpectrum(spectrumValues, spectrum->binWidth());
+            }
+        }
+    }
+    scheduleFrame();
+}
+
+/**
+ * Планирует кадр: сразу, если с прошлого кадра прошло не меньше
+ * frameInterval, иначе по истечении этого интервала. Данные, пришедшие
+ * до кадра, рисуются в нем вместе.
+ */
+void CentralWidget::scheduleFrame() {
+    if(frameTimer->isActive()) {
+        return;
+    }
+    qint64 wait = frameInterval - lastFrame.elapsed();
+    frameTimer->start(wait > 0 ? (int)wait : 0);
+}
+
+/**
+ * Слот кадра: перерисовывает видимые графики, получившие новые данные.
+ * Скрытые графики перерисуются, когда станут видимыми.
+ */
+void CentralWidget::slotFrame() {
+    lastFrame.restart();
+    for(int i = 0; i < (int)channels->size(); i++) {
+        if(dirty[i] && channels->at(i)->isVisible()) {
+            channels->at(i)->update();
+            dirty[i] = false;
+        }
     }
 }
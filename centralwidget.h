@@ -19,12 +19,19 @@
 #define ADCCOLLECTOR_CENTRALWIDGET_H
 #include <QWidget>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <random>
 #include <vector>
+#include <memory>
 #include <QGridLayout>
 #include <QBoxLayout>
+#include <QGuiApplication>
+#include <QScreen>
+#include <cmath>
 #include "chartwidget.h"
 #include "settings.h"
+#include "adc.h"
+#include "spectrum.h"
 
 /**
  * Виджет, в котором находятся все каналы.
@@ -36,12 +43,26 @@ public:
     void clear();
     void reload();
     void changeNumberOfChannels(int indexOfChannel);
-    void setDataForChannels(std::vector<double> dataForChans);
+    void setDataForChannels(const std::vector<DisplayBlock> &blocks);
+    void setMaxFps(int fps);
 
 private:
     std::vector<ChartWidget*> *channels;
-    std::vector<double> *dataForChannels;
     QGridLayout *l;
+    // Кадры: графики с новыми данными перерисовываются не чаще frameInterval (мсек)
+    QTimer *frameTimer;
+    QElapsedTimer lastFrame;
+    int frameInterval;
+    std::vector<bool> dirty;
+    // Спектры каналов в режимах спектра и водопада считаются в отдельном потоке
+    std::unique_ptr<SpectrumWorker> spectrum;
+    std::vector<float> spectrumValues;
+    std::vector<float> waterfallFrames;
+
+    void scheduleFrame();
+
+private slots:
+    void slotFrame();
 
 };
 
@@ -28,6 +28,14 @@ ChannelSettingsWidget::ChannelSettingsWidget(QWidget *parent) : QWidget(parent)
     connect(saveBinaryData, &QCheckBox::toggled, this, &ChannelSettingsWidget::slotSaveBinaryData);
     saveTextData = new QCheckBox(tr("Save text data"), this);
     connect(saveTextData, &QCheckBox::toggled, this, &ChannelSettingsWidget::slotSaveTextData);
+    binaryFormat = new QComboBox(this);
+    binaryFormat->addItem(tr("Blocks"));
+    binaryFormat->addItem(tr("Indexed container"));
+    binaryFormat->addItem(tr("miniSEED (Steim2)"));
+    binaryFormat->addItem(tr("Compressed container"));
+    decimationFilter = new QComboBox(this);
+    decimationFilter->addItem(tr("Mean: block average"));
+    decimationFilter->addItem(tr("Mean: CIC + FIR filter"));
     enabledCheckBox->setChecked(true);
     saveBinaryData->setChecked(true);
     saveTextData->setChecked(true);
@@ -53,6 +61,15 @@ ChannelSettingsWidget::ChannelSettingsWidget(QWidget *parent) : QWidget(parent)
     colorOfGridLabel = new QLabel(tr("Color of grid: "), this);
     colorOfTextLabel = new QLabel(tr("Color of text: "), this);
 
+    extraOutputs = new QLineEdit(this);
+    extraOutputs->setPlaceholderText("container/32, text/800");
+    extraOutputs->setToolTip(tr("Additional outputs: <format>/<factor>[:mean|:fir], separated by commas.\n"
+                                "Formats: blocks, container, compressed, mseed, text.\n"
+                                "Factor divides the sample rate (1 - full rate); with the FIR filter\n"
+                                "factors above 16 need a divisor between 4 and 16."));
+    connect(extraOutputs, &QLineEdit::textChanged, this, &ChannelSettingsWidget::slotCheckExtraOutputs);
+    extraOutputsLabel = new QLabel(tr("Extra outputs: "), this);
+
     colorsLayout = new QHBoxLayout;
     colorsLayout->addWidget(colorOfGridLabel);
     colorsLayout->addWidget(colorOfGridBtn);
@@ -65,14 +82,21 @@ ChannelSettingsWidget::ChannelSettingsWidget(QWidget *parent) : QWidget(parent)
     nameLayout->addWidget(nameLabel);
     nameLayout->addWidget(name);
 
+    outputsLayout = new QHBoxLayout;
+    outputsLayout->addWidget(extraOutputsLabel);
+    outputsLayout->addWidget(extraOutputs);
+
     checkboxesLayout = new QHBoxLayout;
     checkboxesLayout->addWidget(enabledCheckBox);
     checkboxesLayout->addWidget(saveBinaryData);
+    checkboxesLayout->addWidget(binaryFormat);
     checkboxesLayout->addWidget(saveTextData);
+    checkboxesLayout->addWidget(decimationFilter);
 
     labels = new QVBoxLayout(this);
     labels->addLayout(nameLayout);
     labels->addLayout(checkboxesLayout);
+    labels->addLayout(outputsLayout);
     labels->addLayout(colorsLayout);
 }
 
@@ -146,6 +170,19 @@ void ChannelSettingsWidget::slotSaveTextData() {
     saveTextDataFlag = saveTextData->isChecked();
 }
 
+/**
+ * Слот, проверяющий правильность введенных дополнительных выводов.
+ * @param str - текущая строка выводов.
+ */
+void ChannelSettingsWidget::slotCheckExtraOutputs(const QString &str) {
+    std::vector<OutputSpec> specs;
+    if(parseOutputSpecs(str.toStdString(), &specs)) {
+        extraOutputs->setStyleSheet("");
+    } else {
+        extraOutputs->setStyleSheet("color: red");
+    }
+}
+
 /**
  * @return - разрешена ли работа канала.
  */
@@ -195,6 +232,27 @@ bool ChannelSettingsWidget::getSaveTextDataFlag() {
     return saveTextDataFlag;
 }
 
+/**
+ * @return - формат бинарных данных.
+ */
+int ChannelSettingsWidget::getBinaryFormat() {
+    return binaryFormat->currentIndex();
+}
+
+/**
+ * @return - фильтр понижения частоты при усреднении.
+ */
+int ChannelSettingsWidget::getDecimationFilter() {
+    return decimationFilter->currentIndex();
+}
+
+/**
+ * @return - дополнительные выводы канала.
+ */
+QString ChannelSettingsWidget::getExtraOutputs() {
+    return extraOutputs->text();
+}
+
 /**
  * Устанавливает состояние разрешенности работы.
  * @param en - флаг, обозначающий разрешение работы канала.
@@ -257,3 +315,31 @@ void ChannelSettingsWidget::setSaveTextDataFlag(bool f) {
     saveTextDataFlag = f;
     saveTextData->setChecked(saveTextDataFlag);
 }
+
+/**
+ * Устанавливает формат бинарных данных.
+ * @param format - устанавливаемый формат.
+ */
+void ChannelSettingsWidget::setBinaryFormat(int format) {
+    if(format >= 0 && format < binaryFormat->count()) {
+        binaryFormat->setCurrentIndex(format);
+    }
+}
+
+/**
+ * Устанавливает фильтр понижения частоты при усреднении.
+ * @param filter - устанавливаемый фильтр.
+ */
+void ChannelSettingsWidget::setDecimationFilter(int filter) {
+    if(filter >= 0 && filter < decimationFilter->count()) {
+        decimationFilter->setCurrentIndex(filter);
+    }
+}
+
+/**
+ * Устанавливает дополнительные выводы канала.
+ * @param outputs - строка выводов.
+ */
+void ChannelSettingsWidget::setExtraOutputs(QString outputs) {
+    extraOutputs->setText(outputs);
+}
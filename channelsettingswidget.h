@@ -19,6 +19,7 @@
 #define ADCCOLLECTOR_CHANNELSETTINGSWIDGET_H
 #include <QWidget>
 #include <QCheckBox>
+#include <QComboBox>
 #include <QLineEdit>
 #include <QLabel>
 #include <QPushButton>
@@ -27,6 +28,7 @@
 #include <QDebug>
 #include <vector>
 #include "settings.h"
+#include "outputspec.h"
 
 /**
  * Виджет с настройками об одном канале.
@@ -43,6 +45,9 @@ public:
     void setName(QString nameStr);
     void setSaveBinaryDataFlag(bool f);
     void setSaveTextDataFlag(bool f);
+    void setBinaryFormat(int format);
+    void setDecimationFilter(int filter);
+    void setExtraOutputs(QString outputs);
     bool getEnabled();
     QColor getColorOfGrid();
     QColor getColorOfGraph();
@@ -50,11 +55,16 @@ public:
     QString getName();
     bool getSaveBinaryDataFlag();
     bool getSaveTextDataFlag();
+    int getBinaryFormat();
+    int getDecimationFilter();
+    QString getExtraOutputs();
 
 private:
     QCheckBox *enabledCheckBox;
     QCheckBox *saveBinaryData;
     QCheckBox *saveTextData;
+    QComboBox *binaryFormat;
+    QComboBox *decimationFilter;
 
     QString *nameOfChannel;
     QColor *colorOfGrid;
@@ -70,12 +80,15 @@ private:
 
     QLineEdit *name;
     QLabel *nameLabel;
+    QLineEdit *extraOutputs;
+    QLabel *extraOutputsLabel;
     QLabel *colorOfGridLabel;
     QLabel *colorOfGraphLabel;
     QLabel *colorOfTextLabel;
 
     QHBoxLayout *colorsLayout;
     QHBoxLayout *nameLayout;
+    QHBoxLayout *outputsLayout;
     QHBoxLayout *checkboxesLayout;
     QVBoxLayout *labels;
 
@@ -89,6 +102,7 @@ private slots:
     void slotEnabled();
     void slotSaveBinaryData();
     void slotSaveTextData();
+    void slotCheckExtraOutputs(const QString &str);
 };
 
 
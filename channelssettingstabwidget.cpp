@@ -39,6 +39,9 @@ ChannelsSettingsTabWidget::ChannelsSettingsTabWidget(QWidget *parent) : QWidget(
         channelsSets->at(i)->setColorOfText(sets.at(i).colorOfText);
         channelsSets->at(i)->setSaveBinaryDataFlag(sets.at(i).saveBinaryData);
         channelsSets->at(i)->setSaveTextDataFlag(sets.at(i).saveTextData);
+        channelsSets->at(i)->setBinaryFormat(sets.at(i).binaryFormat);
+        channelsSets->at(i)->setDecimationFilter(sets.at(i).decimationFilter);
+        channelsSets->at(i)->setExtraOutputs(sets.at(i).extraOutputs);
         channelsSettings->addWidget(channelSettingsWidget);
     }
 }
@@ -55,6 +58,9 @@ std::vector<ChannelView>* ChannelsSettingsTabWidget::getSets() {
         sets.at(i).colorOfGrid = channelsSets->at(i)->getColorOfGrid();
         sets.at(i).saveBinaryData = channelsSets->at(i)->getSaveBinaryDataFlag();
         sets.at(i).saveTextData = channelsSets->at(i)->getSaveTextDataFlag();
+        sets.at(i).binaryFormat = channelsSets->at(i)->getBinaryFormat();
+        sets.at(i).decimationFilter = channelsSets->at(i)->getDecimationFilter();
+        sets.at(i).extraOutputs = channelsSets->at(i)->getExtraOutputs();
     }
 
     return &sets;
@@ -0,0 +1,131 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "chartbuffer.h"
+
+/**
+ * Конструктор истории отсчетов графика.
+ * @param capacity - максимальное число хранимых отсчетов.
+ * @param bucketLen - число отсчетов в группе огибающей.
+ */
+ChartBuffer::ChartBuffer(size_t capacity, size_t bucketLen) {
+    items.resize(capacity > 0 ? capacity : 1);
+    bucketSize = bucketLen > 0 ? bucketLen : 1;
+    mins.resize(items.size() / bucketSize + 1);
+    maxs.resize(mins.size());
+}
+
+/**
+ * Добавление отсчета. Если буфер заполнен, самый старый отсчет теряется.
+ * @param v - значение отсчета.
+ */
+void ChartBuffer::push(float v) {
+    items[total % items.size()] = v;
+    pushQueues(total, v);
+    size_t b = (total / bucketSize) % mins.size();
+    if (total % bucketSize == 0) {
+        mins[b] = v;
+        maxs[b] = v;
+        if (bucketCount < mins.size()) {
+            bucketCount++;
+        }
+    } else {
+        mins[b] = v < mins[b] ? v : mins[b];
+        maxs[b] = v > maxs[b] ? v : maxs[b];
+    }
+    total++;
+    if (count < items.size()) {
+        count++;
+    }
+}
+
+/**
+ * Добавление отсчетов.
+ * @param values - значения отсчетов.
+ * @param len - число отсчетов.
+ */
+void ChartBuffer::push(const float *values, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        push(values[i]);
+    }
+}
+
+/**
+ * Удаление всех отсчетов.
+ */
+void ChartBuffer::clear() {
+    count = 0;
+    total = 0;
+    bucketCount = 0;
+    minQueue.clear();
+    maxQueue.clear();
+}
+
+/**
+ * Установка числа последних отсчетов, по которым ищутся минимум и максимум.
+ * При изменении окна очереди строятся заново по хранимым отсчетам.
+ * @param len - длина окна.
+ */
+void ChartBuffer::setWindow(size_t len) {
+    len = len < 1 ? 1 : len > items.size() ? items.size() : len;
+    if (len == windowLen) {
+        return;
+    }
+    windowLen = len;
+    minQueue.clear();
+    maxQueue.clear();
+    size_t n = count < windowLen ? count : windowLen;
+    for (uint64_t seq = total - n; seq < total; seq++) {
+        pushQueues(seq, value(seq));
+    }
+}
+
+/**
+ * Добавление отсчета в монотонные очереди и удаление вышедших из окна отсчетов.
+ * @param seq - номер отсчета.
+ * @param v - значение отсчета.
+ */
+void ChartBuffer::pushQueues(uint64_t seq, float v) {
+    while (!minQueue.empty() && value(minQueue.back()) >= v) {
+        minQueue.pop_back();
+    }
+    minQueue.push_back(seq);
+    while (!maxQueue.empty() && value(maxQueue.back()) <= v) {
+        maxQueue.pop_back();
+    }
+    maxQueue.push_back(seq);
+    while (minQueue.front() + windowLen <= seq) {
+        minQueue.pop_front();
+    }
+    while (maxQueue.front() + windowLen <= seq) {
+        maxQueue.pop_front();
+    }
+}
+
+/**
+ * @return - минимум последних window() отсчетов (0, если отсчетов нет).
+ */
+double ChartBuffer::windowMin() const {
+    return minQueue.empty() ? 0 : value(minQueue.front());
+}
+
+/**
+ * @return - максимум последних window() отсчетов (0, если отсчетов нет).
+ */
+double ChartBuffer::windowMax() const {
+    return maxQueue.empty() ? 0 : value(maxQueue.front());
+}
@@ -0,0 +1,142 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_CHARTBUFFER_H
+#define ADCCOLLECTOR_CHARTBUFFER_H
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * История отсчетов графика фиксированной емкости в непрерывном кольцевом
+ * буфере. Минимум и максимум последних window() отсчетов поддерживаются
+ * монотонными очередями, поэтому добавление отсчета и получение
+ * минимума/максимума выполняются за амортизированное O(1).
+ * Одновременно отсчеты сворачиваются в огибающие (минимум и максимум)
+ * групп по bucketLen() отсчетов - по одной группе на столбец пикселей.
+ */
+class ChartBuffer {
+public:
+    ChartBuffer(size_t capacity, size_t bucketLen);
+
+    void push(float value);
+    void push(const float *values, size_t len);
+    void clear();
+    void setWindow(size_t len);
+
+    /**
+     * @return - число хранимых отсчетов.
+     */
+    size_t size() const {
+        return count;
+    }
+
+    /**
+     * @return - емкость буфера.
+     */
+    size_t capacity() const {
+        return items.size();
+    }
+
+    /**
+     * @return - число последних отсчетов, по которым ищутся минимум и максимум.
+     */
+    size_t window() const {
+        return windowLen;
+    }
+
+    /**
+     * @param i - номер отсчета (0 - самый старый из хранимых).
+     * @return - значение отсчета.
+     */
+    float at(size_t i) const {
+        return value(total - count + i);
+    }
+
+    /**
+     * @return - последний отсчет.
+     */
+    float last() const {
+        return value(total - 1);
+    }
+
+    /**
+     * @return - число отсчетов в группе огибающей.
+     */
+    size_t bucketLen() const {
+        return bucketSize;
+    }
+
+    /**
+     * @return - число хранимых групп огибающей (последняя может быть неполной).
+     */
+    size_t buckets() const {
+        return bucketCount;
+    }
+
+    /**
+     * @return - число групп огибающей с начала записи (номер следующей группы).
+     */
+    uint64_t bucketsTotal() const {
+        return (total + bucketSize - 1) / bucketSize;
+    }
+
+    /**
+     * @param i - номер группы (0 - самая старая из хранимых).
+     * @return - минимум группы.
+     */
+    float bucketMin(size_t i) const {
+        return mins[(firstBucket() + i) % mins.size()];
+    }
+
+    /**
+     * @param i - номер группы (0 - самая старая из хранимых).
+     * @return - максимум группы.
+     */
+    float bucketMax(size_t i) const {
+        return maxs[(firstBucket() + i) % maxs.size()];
+    }
+
+    double windowMin() const;
+    double windowMax() const;
+
+private:
+    std::vector<float> items;
+    size_t count = 0;
+    uint64_t total = 0;
+    size_t windowLen = 1;
+    // Номера отсчетов окна с возрастающими (minQueue) и убывающими (maxQueue) значениями
+    std::deque<uint64_t> minQueue;
+    std::deque<uint64_t> maxQueue;
+    // Огибающая: кольцо групп по bucketSize отсчетов
+    size_t bucketSize;
+    size_t bucketCount = 0;
+    std::vector<float> mins;
+    std::vector<float> maxs;
+
+    float value(uint64_t seq) const {
+        return items[seq % items.size()];
+    }
+    uint64_t firstBucket() const {
+        return (total + bucketSize - 1) / bucketSize - bucketCount;
+    }
+    void pushQueues(uint64_t seq, float v);
+};
+
+
+#endif //ADCCOLLECTOR_CHARTBUFFER_H
@@ -16,13 +16,43 @@
  */
 
 #include "chartwidget.h"
+#include <cstring>
+#include <algorithm>
+
+/**
+ * Палитра водопада: от черного через синий, голубой, зеленый, желтый
+ * и красный к белому. Вычисляется один раз.
+ * @return - WATERFALL_COLORS цветов.
+ */
+static const QRgb *waterfallColormap() {
+    static QRgb colormap[WATERFALL_COLORS];
+    static bool ready = false;
+    if(!ready) {
+        const double stops[][4] = {{0.0, 0, 0, 0}, {0.2, 0, 0, 128}, {0.4, 0, 128, 255}, {0.55, 0, 255, 128},
+                                   {0.75, 255, 255, 0}, {0.9, 255, 0, 0}, {1.0, 255, 255, 255}};
+        int s = 0;
+        for(int i = 0; i < WATERFALL_COLORS; i++) {
+            double t = (double)i / (WATERFALL_COLORS - 1);
+            while(t > stops[s + 1][0]) {
+                s++;
+            }
+            double f = (t - stops[s][0]) / (stops[s + 1][0] - stops[s][0]);
+            colormap[i] = qRgb((int)(stops[s][1] + f * (stops[s + 1][1] - stops[s][1])),
+                               (int)(stops[s][2] + f * (stops[s + 1][2] - stops[s][2])),
+                               (int)(stops[s][3] + f * (stops[s + 1][3] - stops[s][3])));
+        }
+        ready = true;
+    }
+    return colormap;
+}
 
 /**
  * Конструктор канала.
+ * @param channel - номер канала.
  * @param parent - указатель на дочерний виджет.
  */
-ChartWidget::ChartWidget(QWidget *parent) : QWidget(parent) {
-    data = new QQueue<double>();
+ChartWidget::ChartWidget(int channel, QWidget *parent) : QWidget(parent) {
+    channelNumber = channel;
     interval = tr("Automatic");
     enabled = true;
     autoMinMax = true;
@@ -42,151 +72,421 @@ ChartWidget::ChartWidget(QWidget *parent) : QWidget(parent) {
 
 /**
  * Рисует сетку графика данных.
+ * @param painter - рисовальщик слоя сетки.
  * @param gridColor - цвет сетки.
  * @param textColor - цвет значений на сетке.
  */
-void ChartWidget::drawGrid(QColor gridColor, QColor textColor) {
-    QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing, false);
+void ChartWidget::drawGrid(QPainter *painter, QColor gridColor, QColor textColor) {
+    painter->setRenderHint(QPainter::Antialiasing, false);
 
     //YAxes:
     double middleCoord = heightOfChartWidget / 2;
-    int numberOfHorizontalLines = 0;
-    QFont font = painter.font();
+    QFont font = painter->font();
     font.setPixelSize(12);
-    painter.setFont(font);
-    painter.setPen(gridColor);
+    painter->setFont(font);
+    painter->setPen(gridColor);
     for(int i = middleCoord - Y_STEP_IN_PIXELS; i > 0; i -= Y_STEP_IN_PIXELS) {
-        painter.drawLine(0, i, widthOfChartWidget, i);
-        numberOfHorizontalLines++;
+        painter->drawLine(0, i, widthOfChartWidget, i);
     }
-    numberOfHorizontalLines = numberOfHorizontalLines * 2;
-    yStepInNumber = (max - min) / numberOfHorizontalLines;
     double numberNearLines = min + ((max - min) / 2) + yStepInNumber;
 
-    painter.setPen(textColor);
+    painter->setPen(textColor);
     for(int i = middleCoord - Y_STEP_IN_PIXELS; i > 0; i -= Y_STEP_IN_PIXELS) {
-        painter.drawText(2, i + 5, QString("%1").arg(numberNearLines, 0, 'f', 2));
+        painter->drawText(2, i + 5, QString("%1").arg(numberNearLines, 0, 'f', 2));
         numberNearLines += yStepInNumber;
     }
 
-    painter.setPen(gridColor);
+    painter->setPen(gridColor);
     for(int i = middleCoord + Y_STEP_IN_PIXELS; i < heightOfChartWidget; i += Y_STEP_IN_PIXELS) {
-        painter.drawLine(0, i, widthOfChartWidget, i);
+        painter->drawLine(0, i, widthOfChartWidget, i);
     }
     numberNearLines = (min + ((max - min) / 2)) - yStepInNumber;
 
-    painter.setPen(textColor);
+    painter->setPen(textColor);
     for(int i = middleCoord + Y_STEP_IN_PIXELS; i < heightOfChartWidget; i += Y_STEP_IN_PIXELS) {
-        painter.drawText(2, i + 5, QString("%1").arg(numberNearLines, 0, 'f', 2));
+        painter->drawText(2, i + 5, QString("%1").arg(numberNearLines, 0, 'f', 2));
         numberNearLines -= yStepInNumber;
     }
 
     //MiddleLine:
-    painter.setPen(QPen(gridColor, 3));
-    painter.drawLine(0, middleCoord, widthOfChartWidget, middleCoord);
+    painter->setPen(QPen(gridColor, 3));
+    painter->drawLine(0, middleCoord, widthOfChartWidget, middleCoord);
 
-    painter.setPen(textColor);
-    painter.drawText(2, middleCoord + 5, QString("%1").arg(min + ((max - min) / 2), 0, 'f', 2));
+    painter->setPen(textColor);
+    painter->drawText(2, middleCoord + 5, QString("%1").arg(min + ((max - min) / 2), 0, 'f', 2));
 
     //XAxes:
-    painter.setPen(gridColor);
+    painter->setPen(gridColor);
     for(int i = X_STEP_IN_PIXELS; i < widthOfChartWidget; i += X_STEP_IN_PIXELS) {
-        painter.drawLine(i, 0, i, heightOfChartWidget);
+        painter->drawLine(i, 0, i, heightOfChartWidget);
     }
 }
 
 /**
- * Рисует график данных.
+ * Рисует часть графика одной ломаной: в каждом столбце пикселей она проходит
+ * от максимума до минимума его отсчетов (в соседних столбцах - в обратном
+ * порядке), поэтому короткие выбросы не теряются, а число вершин
+ * не зависит от числа отсчетов.
+ * @param painter - рисовальщик слоя графика.
+ * @param from - номер первой рисуемой группы огибающей (с начала записи).
+ * @param to - номер группы, следующей за последней рисуемой.
+ * @param first - номер группы в левом столбце.
  */
-void ChartWidget::drawGraph() {
-    QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing, true);
+void ChartWidget::drawGraph(QPainter *painter, uint64_t from, uint64_t to, uint64_t first) {
+    painter->setRenderHint(QPainter::Antialiasing, false);
+    painter->setPen(QPen(colorOfGraph, 1));
 
-    numberOfDrawingData = this->width() / stepOfGraphInPixels + 1;
     //Graph:
-    if(data->size() > 1) {
-        painter.setPen(QPen(colorOfGraph, 1.5));
-        int j;
-        if(data->size() < numberOfDrawingData) {
-            j = 1;
+    double distanceAmongMaxAndMinInPixels = ((max - min) / yStepInNumber) * Y_STEP_IN_PIXELS;
+    double bottom = distanceAmongMaxAndMinInPixels + ((heightOfChartWidget - distanceAmongMaxAndMinInPixels) / 2);
+    double pixelsPerVolt = Y_STEP_IN_PIXELS / yStepInNumber;
+    uint64_t oldest = data.bucketsTotal() - data.buckets();
+    // Ломаная начинается с предыдущего столбца, чтобы соединиться с уже нарисованной частью
+    uint64_t start = from > first ? from - 1 : from;
+    trace.resize(2 * (to - start));
+    QPointF *points = trace.data();
+    for(uint64_t j = start; j < to; j++) {
+        double x = j - first + 0.5;
+        double yHi = qBound(0.0, bottom - (data.bucketMax(j - oldest) - min) * pixelsPerVolt, (double)heightOfChartWidget);
+        double yLo = qBound(0.0, bottom - (data.bucketMin(j - oldest) - min) * pixelsPerVolt, (double)heightOfChartWidget);
+        if((j & 1) == 0) {
+            *points++ = QPointF(x, yHi);
+            *points++ = QPointF(x, yLo + 1);
         } else {
-            j = data->size() - numberOfDrawingData + 1;
-        }
-        int k = 0;
-        for(int i = j; i < data->size(); i++) {
-            double distanceAmongMaxAndMinInPixels = ((max - min) / yStepInNumber) * Y_STEP_IN_PIXELS;
-            double x1 = stepOfGraphInPixels * k;
-            double x2 = stepOfGraphInPixels * (k + 1);
-            double y1 = distanceAmongMaxAndMinInPixels + ((heightOfChartWidget - distanceAmongMaxAndMinInPixels) / 2) -
-                        (data->at(i - 1) - min) / yStepInNumber * Y_STEP_IN_PIXELS;
-            double y2 = distanceAmongMaxAndMinInPixels + ((heightOfChartWidget - distanceAmongMaxAndMinInPixels) / 2) -
-                        (data->at(i) - min) / yStepInNumber * Y_STEP_IN_PIXELS;
-            painter.drawLine(x1, y1, x2, y2);
-            k++;
+            *points++ = QPointF(x, yLo + 1);
+            *points++ = QPointF(x, yHi);
         }
     }
-
+    painter->drawPolyline(trace);
 }
 
 /**
- * Рисует имя канала, текущее значение данных и интервал в котором рисуется график.
+ * Обновляет слой графика. Если с прошлого кадра изменились только данные,
+ * слой сдвигается влево на число новых столбцов и дорисовываются только
+ * новые столбцы (и последний столбец прошлого кадра, который мог быть
+ * неполным). При изменении размера, интервала значений или настроек
+ * слой рисуется заново.
  */
-void ChartWidget::drawLabels() {
-    QPainter painter(this);
+void ChartWidget::updateTraceLayer() {
+    uint64_t total = data.bucketsTotal();
+    uint64_t oldest = total - data.buckets();
+    uint64_t first = total > oldest + numberOfDrawingData ? total - numberOfDrawingData : oldest;
+    bool full = !traceValid || traceLayer.size() != this->size() || min != traceMin || max != traceMax ||
+                first < traceFirst || total < traceEnd || first - traceFirst >= (uint64_t)widthOfChartWidget;
+
+    uint64_t from = first;
+    if(full) {
+        traceLayer = QImage(this->size(), QImage::Format_ARGB32_Premultiplied);
+        traceLayer.fill(Qt::transparent);
+    } else {
+        int shift = (int)(first - traceFirst);
+        if(shift > 0) {
+            int rowBytes = (traceLayer.width() - shift) * 4;
+            for(int y = 0; y < traceLayer.height(); y++) {
+                uchar *line = traceLayer.scanLine(y);
+                memmove(line, line + shift * 4, rowBytes);
+            }
+        }
+        from = traceEnd > first ? traceEnd - 1 : first;
+        QPainter clearPainter(&traceLayer);
+        clearPainter.setCompositionMode(QPainter::CompositionMode_Source);
+        clearPainter.fillRect(QRect((int)(from - first), 0, widthOfChartWidget, heightOfChartWidget), Qt::transparent);
+    }
+    if(data.size() > 1 && from < total) {
+        QPainter painter(&traceLayer);
+        drawGraph(&painter, from, total, first);
+    }
+    traceValid = true;
+    traceFirst = first;
+    traceEnd = total;
+    traceMin = min;
+    traceMax = max;
+}
 
+/**
+ * Рисует имя канала и интервал, в котором рисуется график.
+ * @param painter - рисовальщик слоя сетки.
+ * @param intervalText - подпись интервала (пустая, если не рисуется).
+ */
+void ChartWidget::drawLabels(QPainter *painter, const QString &intervalText) {
     //Name of channel:
-    QFont nameFont(painter.font());
+    QFont nameFont(painter->font());
     nameFont.setPixelSize(18);
-    painter.setFont(nameFont);
+    painter->setFont(nameFont);
     QFontMetrics nameFontFM(nameFont);
 
-    painter.setPen(colorOfText);
+    painter->setPen(colorOfText);
     int nameWidthInPixels = nameFontFM.width(name);
-    painter.drawText(widthOfChartWidget / 2 - nameWidthInPixels / 2, 20, name);
+    painter->drawText(widthOfChartWidget / 2 - nameWidthInPixels / 2, 20, name);
+
+    if(!intervalText.isEmpty()) {
+        QFont intervalFont(painter->font());
+        intervalFont.setPixelSize(20);
+        QFontMetrics intervalFontFM(intervalFont);
+        painter->setFont(intervalFont);
+        int intervalWidthInPixels = intervalFontFM.width(intervalText);
+        painter->setPen(QPen(colorOfText, 20));
+        painter->drawText(widthOfChartWidget - intervalWidthInPixels - 10, heightOfChartWidget - 5, intervalText);
+    }
+}
 
-    //Current data:
-    if(!data->empty()) {
-        QFont dataFont(painter.font());
+/**
+ * Рисует текущее значение данных.
+ * @param painter - рисовальщик виджета.
+ */
+void ChartWidget::drawCurrentValue(QPainter *painter) {
+    if(data.size() > 0) {
+        QFont dataFont(painter->font());
         dataFont.setPixelSize(28);
         QFontMetrics dataFontFM(dataFont);
-        painter.setFont(dataFont);
-        QString dataString = QString("%1").arg(data->at(data->size() - 1), 0, 'f', 2);
+        painter->setFont(dataFont);
+        painter->setPen(colorOfText);
+        QString dataString = QString("%1").arg(data.last(), 0, 'f', 2);
         int dataWidthInPixels = dataFontFM.width(dataString);
-        painter.drawText(widthOfChartWidget - dataWidthInPixels - 10, 25, dataString);
+        painter->drawText(widthOfChartWidget - dataWidthInPixels - 10, 25, dataString);
     }
+}
 
-    if(enabled && channelEnabled && data->size() > 1) {
-        if(autoMinMax) {
-            interval = tr("Automatic");
-        } else {
-            interval = QString::number(min) + "..." + QString::number(max) + " V";
+/**
+ * Рисует спектр канала: частота от нуля до частоты Найквиста по горизонтали,
+ * плотность мощности в дБ по вертикали. Интервал по вертикали округляется
+ * до 10 дБ, шаги сетки выбираются так, чтобы подписи не налезали друг на друга.
+ * @param painter - рисовальщик виджета.
+ */
+void ChartWidget::drawSpectrum(QPainter *painter) {
+    painter->setRenderHint(QPainter::Antialiasing, false);
+    QColor gridColor = channelEnabled ? colorOfGrid : disabledColorOfGrid;
+    QColor textColor = channelEnabled ? colorOfText : disabledColorOfText;
+    bool show = enabled && channelEnabled && spectrum.size() > 1;
+
+    // Нулевая частота (постоянная составляющая) в интервал не входит
+    double lo = -100;
+    double hi = 0;
+    if(show) {
+        auto range = std::minmax_element(spectrum.begin() + 1, spectrum.end());
+        lo = floor(*range.first / 10) * 10;
+        hi = std::max(ceil(*range.second / 10) * 10, lo + 10);
+    }
+    double nyquist = show ? spectrumBinHz * (spectrum.size() - 1) : 0;
+
+    QFont font = painter->font();
+    font.setPixelSize(12);
+    painter->setFont(font);
+    double pixelsPerDb = heightOfChartWidget / (hi - lo);
+    int dbStep = 10;
+    while(dbStep * pixelsPerDb < Y_STEP_IN_PIXELS) {
+        dbStep += 10;
+    }
+    for(double db = lo; db <= hi; db += dbStep) {
+        int y = (int)(heightOfChartWidget - (db - lo) * pixelsPerDb);
+        painter->setPen(gridColor);
+        painter->drawLine(0, y, widthOfChartWidget, y);
+        painter->setPen(textColor);
+        painter->drawText(2, qBound(12, y - 3, heightOfChartWidget - 3), QString("%1 dB").arg(db));
+    }
+    if(nyquist > 0) {
+        double pixelsPerHz = widthOfChartWidget / nyquist;
+        // Шаг по частоте из ряда 1, 2, 5, 10, 20, 50...
+        double hzStep = pow(10, floor(log10(nyquist)) - 2);
+        for(int i = 0; hzStep * pixelsPerHz < 2 * X_STEP_IN_PIXELS; i++) {
+            hzStep *= (i % 3 == 1) ? 2.5 : 2;
         }
-        QFont intervalFont(painter.font());
-        intervalFont.setPixelSize(20);
-        QFontMetrics intervalFontFM(intervalFont);
-        painter.setFont(intervalFont);
-        int intervalWidthInPixels = intervalFontFM.width(interval);
-        painter.setPen(QPen(colorOfText, 20));
-        painter.drawText(widthOfChartWidget - intervalWidthInPixels - 10, heightOfChartWidget - 5, interval);
+        for(double hz = hzStep; hz < nyquist; hz += hzStep) {
+            int x = (int)(hz * pixelsPerHz);
+            painter->setPen(gridColor);
+            painter->drawLine(x, 0, x, heightOfChartWidget);
+            painter->setPen(textColor);
+            painter->drawText(x + 2, heightOfChartWidget - 5, QString("%1 Hz").arg(hz));
+        }
+    }
+
+    if(show) {
+        double pixelsPerBin = (double)widthOfChartWidget / (spectrum.size() - 1);
+        trace.resize(spectrum.size());
+        for(size_t k = 0; k < spectrum.size(); k++) {
+            trace[k] = QPointF(k * pixelsPerBin, heightOfChartWidget - (spectrum[k] - lo) * pixelsPerDb);
+        }
+        painter->setPen(QPen(colorOfGraph, 1));
+        painter->drawPolyline(trace);
+        traceValid = false;
+    }
+
+    if(channelEnabled) {
+        QFont nameFont(painter->font());
+        nameFont.setPixelSize(18);
+        painter->setFont(nameFont);
+        painter->setPen(colorOfText);
+        QString title = name + " - " + tr("PSD, dB re 1 V²/Hz");
+        painter->drawText(widthOfChartWidget / 2 - QFontMetrics(nameFont).width(title) / 2, 20, title);
+    }
+}
+
+/**
+ * Создает изображение водопада по размеру виджета и сопоставляет строкам
+ * изображения частоты спектра (нижняя строка - нулевая частота).
+ * @param bins - число частот спектра.
+ */
+void ChartWidget::resetWaterfall(size_t bins) {
+    waterfall = QImage(this->size(), QImage::Format_RGB32);
+    waterfall.fill(Qt::black);
+    waterfallPos = 0;
+    waterfallBins = bins;
+    int rows = waterfall.height();
+    // Строка y охватывает частоты от waterfallRows[y] до waterfallRows[y + 1]
+    waterfallRows.resize(rows + 1);
+    for(int y = 0; y <= rows; y++) {
+        waterfallRows[y] = (size_t)((double)(rows - y) * bins / rows);
     }
 }
 
 /**
- * Отрисовывает весь виджет.
+ * Добавляет в водопад по столбцу на каждый спектр отрезка. Изменяется только
+ * новый столбец изображения: цвет берется из палитры по уровню в пределах
+ * WATERFALL_RANGE_DB от нижней границы, выбранной по первому спектру.
+ * Пропуск спектров отмечается серым столбцом, чтобы шкала времени оставалась
+ * равномерной по обе стороны от него. Перерисовку планирует CentralWidget.
+ * @param frames - спектры (дБ) от старого к новому.
+ * @param count - число спектров.
+ * @param bins - число частот в спектре.
+ * @param binHz - шаг по частоте (Гц).
+ * @param gap - перед спектрами были пропущены отрезки.
+ */
+void ChartWidget::addWaterfallFrames(const float *frames, size_t count, size_t bins, double binHz, bool gap) {
+    if(count == 0 || bins < 2 || this->width() <= 0 || this->height() <= 0) {
+        return;
+    }
+    if(waterfall.size() != this->size() || waterfallBins != bins) {
+        resetWaterfall(bins);
+        // Нижняя граница палитры - на 10 дБ ниже медианы первого спектра
+        std::vector<float> sorted(frames, frames + bins);
+        std::nth_element(sorted.begin(), sorted.begin() + bins / 2, sorted.end());
+        waterfallLo = floor(sorted[bins / 2] / 10) * 10 - 10;
+    }
+    spectrumBinHz = binHz;
+    const QRgb *colormap = waterfallColormap();
+    double colorsPerDb = (WATERFALL_COLORS - 1) / (double)WATERFALL_RANGE_DB;
+    int rows = waterfall.height();
+    uchar *bits = waterfall.bits();
+    int stride = waterfall.bytesPerLine();
+    if(gap) {
+        for(int y = 0; y < rows; y++) {
+            ((QRgb *)(bits + y * stride))[waterfallPos] = WATERFALL_GAP_COLOR;
+        }
+        waterfallPos = (waterfallPos + 1) % waterfall.width();
+    }
+    for(size_t f = 0; f < count; f++) {
+        const float *frame = frames + f * bins;
+        for(int y = 0; y < rows; y++) {
+            // Строке соответствует одна или несколько частот, берется наибольший уровень
+            size_t k0 = waterfallRows[y + 1];
+            size_t k1 = std::max(waterfallRows[y], k0 + 1);
+            float level = frame[k0];
+            for(size_t k = k0 + 1; k < k1 && k < bins; k++) {
+                level = std::max(level, frame[k]);
+            }
+            int color = qBound(0, (int)((level - waterfallLo) * colorsPerDb), WATERFALL_COLORS - 1);
+            ((QRgb *)(bits + y * stride))[waterfallPos] = colormap[color];
+        }
+        waterfallPos = (waterfallPos + 1) % waterfall.width();
+    }
+}
+
+/**
+ * Рисует водопад: время по горизонтали (новые столбцы справа), частота
+ * по вертикали. Изображение пишется по кругу, поэтому рисуется двумя частями
+ * без сдвига содержимого.
+ * @param painter - рисовальщик виджета.
+ */
+void ChartWidget::drawWaterfall(QPainter *painter) {
+    if(!waterfall.isNull() && enabled && channelEnabled) {
+        int w = waterfall.width();
+        int h = waterfall.height();
+        painter->drawImage(QRect(0, 0, w - waterfallPos, h), waterfall, QRect(waterfallPos, 0, w - waterfallPos, h));
+        painter->drawImage(QRect(w - waterfallPos, 0, waterfallPos, h), waterfall, QRect(0, 0, waterfallPos, h));
+    }
+    QColor textColor = channelEnabled ? colorOfText : disabledColorOfText;
+    QFont font = painter->font();
+    font.setPixelSize(12);
+    painter->setFont(font);
+    painter->setPen(textColor);
+    if(waterfallBins > 1 && spectrumBinHz > 0) {
+        double nyquist = spectrumBinHz * (waterfallBins - 1);
+        for(int i = 0; i <= 4; i++) {
+            int y = heightOfChartWidget - heightOfChartWidget * i / 4;
+            painter->drawText(2, qBound(12, y - 3, heightOfChartWidget - 3),
+                              QString("%1 Hz").arg(nyquist * i / 4, 0, 'f', 1));
+        }
+        QString rangeText = QString("%1...%2 dB").arg(waterfallLo).arg(waterfallLo + WATERFALL_RANGE_DB);
+        painter->drawText(widthOfChartWidget - QFontMetrics(font).width(rangeText) - 10, heightOfChartWidget - 5,
+                          rangeText);
+    }
+    if(channelEnabled) {
+        QFont nameFont(painter->font());
+        nameFont.setPixelSize(18);
+        painter->setFont(nameFont);
+        QString title = name + " - " + tr("Waterfall");
+        painter->drawText(widthOfChartWidget / 2 - QFontMetrics(nameFont).width(title) / 2, 20, title);
+    }
+}
+
+/**
+ * Перерисовывает слой с сеткой и подписями. Слой меняется только
+ * при изменении размера, интервала значений или настроек канала.
+ * @param intervalText - подпись интервала (пустая, если не рисуется).
+ */
+void ChartWidget::renderGridLayer(const QString &intervalText) {
+    qreal ratio = this->devicePixelRatioF();
+    gridLayer = QPixmap(this->size() * ratio);
+    gridLayer.setDevicePixelRatio(ratio);
+    gridLayer.fill(this->palette().color(QPalette::Background));
+
+    QPainter painter(&gridLayer);
+    painter.setFont(this->font());
+    if(channelEnabled) {
+        drawGrid(&painter, colorOfGrid, colorOfText);
+        drawLabels(&painter, intervalText);
+    } else {
+        drawGrid(&painter, disabledColorOfGrid, disabledColorOfText);
+    }
+    gridValid = true;
+    gridMin = min;
+    gridMax = max;
+    gridInterval = intervalText;
+}
+
+/**
+ * Отрисовывает весь виджет: слой сетки из кэша, затем график и текущее значение.
  */
 void ChartWidget::paintEvent(QPaintEvent *) {
     if(!this->isVisible()) {
         return;
     }
-    QPainter painter(this);
     widthOfChartWidget = this->width();
     heightOfChartWidget = this->height();
+    if(mode == CHART_MODE_SPECTRUM) {
+        QPainter painter(this);
+        drawSpectrum(&painter);
+        return;
+    }
+    if(mode == CHART_MODE_WATERFALL) {
+        QPainter painter(this);
+        drawWaterfall(&painter);
+        return;
+    }
+    // Минимум и максимум ищутся по отсчетам видимых столбцов
+    numberOfDrawingData = widthOfChartWidget;
+    data.setWindow(numberOfDrawingData * CHART_SAMPLES_PER_COLUMN);
 
-    if (data->size() > 1 && enabled && channelEnabled) {
+    if (data.size() > 1 && enabled && channelEnabled) {
         if(autoMinMax) {
-            min = findMin();
-            max = findMax();
+            min = data.windowMin();
+            max = data.windowMax();
+            // Интервал расширяется до шага в 1/10 его порядка, чтобы слой сетки не перерисовывался каждый кадр
+            if(max > min) {
+                double quantum = pow(10, floor(log10(max - min)) - 1);
+                min = floor(min / quantum) * quantum;
+                max = ceil(max / quantum) * quantum;
+            }
         } else {
             min = selectedMin;
             max = selectedMax;
@@ -195,17 +495,33 @@ void ChartWidget::paintEvent(QPaintEvent *) {
         min = 0;
         max = 0;
     }
+    // Цена деления: интервал делится на число горизонтальных линий сетки
+    int numberOfHorizontalLines = ((heightOfChartWidget / 2 - 1) / Y_STEP_IN_PIXELS) * 2;
+    yStepInNumber = (max - min) / numberOfHorizontalLines;
 
-    if(channelEnabled) {
-        drawGrid(colorOfGrid, colorOfText);
-    } else {
-        drawGrid(disabledColorOfGrid, disabledColorOfText);
+    QString intervalText;
+    if(enabled && channelEnabled && data.size() > 1) {
+        if(autoMinMax) {
+            intervalText = tr("Automatic");
+        } else {
+            intervalText = QString::number(min) + "..." + QString::number(max) + " V";
+        }
     }
+    interval = intervalText;
+
+    if(!gridValid || gridLayer.size() != this->size() * this->devicePixelRatioF() || min != gridMin ||
+       max != gridMax || intervalText != gridInterval) {
+        renderGridLayer(intervalText);
+    }
+
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, gridLayer);
     if(enabled && channelEnabled) {
-        drawGraph();
+        updateTraceLayer();
+        painter.drawImage(0, 0, traceLayer);
     }
     if(channelEnabled) {
-        drawLabels();
+        drawCurrentValue(&painter);
     }
 }
 
@@ -219,6 +535,8 @@ void ChartWidget::setSettings(ChannelView channelView) {
     colorOfText = channelView.colorOfText;
     colorOfGrid = channelView.colorOfGrid;
     colorOfGraph = channelView.colorOfGraph;
+    gridValid = false;
+    traceValid = false;
     this->update();
 }
 
@@ -244,48 +562,40 @@ void ChartWidget::setMin(double minValue) {
  * Очищает массив с данными.
  */
 void ChartWidget::clear() {
-    data->clear();
-    this->repaint();
+    data.clear();
+    spectrum.clear();
+    waterfall = QImage();
+    waterfallBins = 0;
+    traceValid = false;
+    this->update();
 }
 
 /**
- * Добавляет текущее полученное значение в очередь с данными, которые рисуются на экране.
- * @param value - полученное значение.
+ * Добавляет полученные отсчеты в историю отсчетов, которые рисуются на экране.
+ * Перерисовку планирует CentralWidget.
+ * @param values - полученные отсчеты.
+ * @param len - число отсчетов.
  */
-void ChartWidget::addChartValue(double value) {
-    data->enqueue(value);
-    if(data->size() > this->width() / stepOfGraphInPixels + 1) {
-        data->dequeue();
-    }
-    this->repaint();
+void ChartWidget::addChartValues(const float *values, size_t len) {
+    data.push(values, len);
 }
 
 /**
- * Поиск минимального значения в очереди данных.
- * @return - минимальное значение в очереди данных.
+ * Устанавливает новый спектр канала для режима спектра.
+ * Перерисовку планирует CentralWidget.
+ * @param psd - спектральная плотность мощности (дБ) от нуля до частоты Найквиста.
+ * @param binHz - шаг по частоте (Гц).
  */
-double ChartWidget::findMin() {
-    double minVal = data->at(0);
-    for(int i = 1; i < data->size(); i++) {
-        if(data->at(i) < minVal) {
-            minVal = data->at(i);
-        }
-    }
-    return minVal;
+void ChartWidget::setSpectrum(const std::vector<float> &psd, double binHz) {
+    spectrum.assign(psd.begin(), psd.end());
+    spectrumBinHz = binHz;
 }
 
 /**
- * Поиск максимального значения в очереди данных.
- * @return - максимальное значение в очереди данных.
+ * @return - режим отображения канала (CHART_MODE_*).
  */
-double ChartWidget::findMax() {
-    double maxVal = data->at(0);
-    for(int i = 1; i < data->size(); i++) {
-        if(data->at(i) > maxVal) {
-            maxVal = data->at(i);
-        }
-    }
-    return maxVal;
+int ChartWidget::displayMode() {
+    return mode;
 }
 
 /**
@@ -323,6 +633,19 @@ void ChartWidget::initActions() {
     enabledAction->setChecked(true);
     connect(enabledAction, &QAction::toggled, this,  &ChartWidget::slotEnabledAction);
 
+    historyAction = new QAction(tr("History..."), this);
+    connect(historyAction, &QAction::triggered, this, &ChartWidget::slotHistory);
+
+    modeGroup = new QActionGroup(this);
+    traceModeAction = new QAction(tr("Trace"), modeGroup);
+    traceModeAction->setCheckable(true);
+    traceModeAction->setChecked(true);
+    spectrumModeAction = new QAction(tr("Spectrum"), modeGroup);
+    spectrumModeAction->setCheckable(true);
+    waterfallModeAction = new QAction(tr("Waterfall"), modeGroup);
+    waterfallModeAction->setCheckable(true);
+    connect(modeGroup, &QActionGroup::triggered, this, &ChartWidget::slotModeAction);
+
     autoIntervalAction = new QAction(tr("Auto"), this);
     connect(autoIntervalAction, &QAction::triggered, this, &ChartWidget::slotAutoMinMax);
 
@@ -355,6 +678,9 @@ void ChartWidget::initPopupMenu() {
     popupMenu = new QMenu(this);
 
     popupMenu->addAction(enabledAction);
+    popupMenu->addAction(historyAction);
+    popupMenu->addSeparator();
+    popupMenu->addActions(modeGroup->actions());
     popupMenu->addSeparator();
     popupMenu->addAction(autoIntervalAction);
     popupMenu->addAction(oneHundredthIntervalAction);
@@ -372,6 +698,7 @@ void ChartWidget::initPopupMenu() {
  */
 void ChartWidget::slotEnabledAction(bool en) {
     enabled = en;
+    traceValid = false;
 
     autoIntervalAction->setEnabled(enabled);
     oneHundredthIntervalAction->setEnabled(enabled);
@@ -385,6 +712,34 @@ void ChartWidget::slotEnabledAction(bool en) {
     this->update();
 }
 
+/**
+ * Слот открывает окно истории канала по данным архива.
+ */
+void ChartWidget::slotHistory() {
+    HistoryWidget *history = new HistoryWidget(channelNumber, this);
+    history->show();
+}
+
+/**
+ * Слот переключает режим отображения канала (график, спектр или водопад).
+ * @param action - выбранное действие группы режимов.
+ */
+void ChartWidget::slotModeAction(QAction *action) {
+    if(action == spectrumModeAction) {
+        mode = CHART_MODE_SPECTRUM;
+    } else if(action == waterfallModeAction) {
+        mode = CHART_MODE_WATERFALL;
+    } else {
+        mode = CHART_MODE_TRACE;
+    }
+    spectrum.clear();
+    waterfall = QImage();
+    waterfallBins = 0;
+    gridValid = false;
+    traceValid = false;
+    this->update();
+}
+
 /**
  * Слот устанавливает минимальное и максимальное значения данных для отображения из контекстного меню.
  */
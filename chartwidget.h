@@ -20,13 +20,34 @@
 #include <QWidget>
 #include <QLabel>
 #include <QMenu>
-#include <QQueue>
 #include <QPainter>
+#include <QPixmap>
+#include <QImage>
+#include <QPolygonF>
 #include <QContextMenuEvent>
+#include <QActionGroup>
 #include <QDebug>
 #include <string>
+#include <vector>
 #include <math.h>
 #include "settings.h"
+#include "chartbuffer.h"
+#include "historywidget.h"
+
+// Samples kept per channel (30 minutes at 800 Hz)
+#define CHART_HISTORY_LEN 1440000
+// Samples reduced to a min/max envelope per pixel column
+#define CHART_SAMPLES_PER_COLUMN 16
+// Display modes
+#define CHART_MODE_TRACE 0
+#define CHART_MODE_SPECTRUM 1
+#define CHART_MODE_WATERFALL 2
+// Colors in the waterfall colormap
+#define WATERFALL_COLORS 256
+// Range of the waterfall colormap above its lower bound (dB)
+#define WATERFALL_RANGE_DB 80
+// Color of the waterfall column that marks lost spectra
+#define WATERFALL_GAP_COLOR qRgb(128, 128, 128)
 
 /**
  * Канал.
@@ -35,19 +56,22 @@ class ChartWidget : public QWidget {
 Q_OBJECT
 
 public:
-    explicit ChartWidget(QWidget *parent = nullptr);
+    explicit ChartWidget(int channel, QWidget *parent = nullptr);
     void setMax(double max);
     void setMin(double min);
     void setSettings(ChannelView channelView);
-    void addChartValue(double value);
+    void addChartValues(const float *values, size_t len);
+    void setSpectrum(const std::vector<float> &psd, double binHz);
+    void addWaterfallFrames(const float *frames, size_t count, size_t bins, double binHz, bool gap);
+    int displayMode();
     void clear();
 
 private:
     const int Y_STEP_IN_PIXELS = 30;
     const int X_STEP_IN_PIXELS = 40;
-    const int stepOfGraphInPixels = 2;
 
-    QQueue<double> *data;
+    int channelNumber;
+    ChartBuffer data {CHART_HISTORY_LEN, CHART_SAMPLES_PER_COLUMN};
     QString name;
     double min;
     double max;
@@ -67,8 +91,38 @@ private:
     double selectedMax;
     QString interval;
 
+    // Слой сетки и подписей, перерисовывается только при изменении размера, интервала или настроек
+    QPixmap gridLayer;
+    bool gridValid = false;
+    double gridMin = 0;
+    double gridMax = 0;
+    QString gridInterval;
+    // Слой графика: сдвигается при поступлении данных, дорисовываются только новые столбцы
+    QImage traceLayer;
+    bool traceValid = false;
+    uint64_t traceFirst = 0;
+    uint64_t traceEnd = 0;
+    double traceMin = 0;
+    double traceMax = 0;
+    QPolygonF trace;
+    // Спектральная плотность мощности (дБ) в режиме спектра
+    int mode = CHART_MODE_TRACE;
+    std::vector<float> spectrum;
+    double spectrumBinHz = 0;
+    // Водопад: столбец на каждый спектр отрезка, пишется по кругу в позицию waterfallPos
+    QImage waterfall;
+    int waterfallPos = 0;
+    size_t waterfallBins = 0;
+    double waterfallLo = 0;
+    std::vector<size_t> waterfallRows;
+
     QMenu *popupMenu;
     QAction *enabledAction;
+    QAction *historyAction;
+    QActionGroup *modeGroup;
+    QAction *traceModeAction;
+    QAction *spectrumModeAction;
+    QAction *waterfallModeAction;
     QAction *autoIntervalAction;
     QAction *oneHundredthIntervalAction;
     QAction *fiveHundredthIntervalAction;
@@ -78,11 +132,15 @@ private:
     QAction *oneAndFiveTenthIntervalAction;
     QAction *twoAndFiveTenthIntervalAction;
 
-    double findMin();
-    double findMax();
-    void drawGrid(QColor gridColor, QColor textColor);
-    void drawGraph();
-    void drawLabels();
+    void drawGrid(QPainter *painter, QColor gridColor, QColor textColor);
+    void drawGraph(QPainter *painter, uint64_t from, uint64_t to, uint64_t first);
+    void updateTraceLayer();
+    void drawLabels(QPainter *painter, const QString &intervalText);
+    void drawCurrentValue(QPainter *painter);
+    void drawSpectrum(QPainter *painter);
+    void drawWaterfall(QPainter *painter);
+    void resetWaterfall(size_t bins);
+    void renderGridLayer(const QString &intervalText);
     void initPopupMenu();
     void initActions();
     void setMinMax(double minVal, double maxVal);
@@ -95,6 +153,8 @@ protected:
 
 private slots:
     void slotEnabledAction(bool en);
+    void slotHistory();
+    void slotModeAction(QAction *action);
     void slotAutoMinMax();
     void slotAct0_01();
     void slotAct0_05();
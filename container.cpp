@@ -0,0 +1,570 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "container.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * Построение таблицы CRC-32.
+ * @return - таблица.
+ */
+static std::array<uint32_t, 256> makeCrcTable() {
+    std::array<uint32_t, 256> table;
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+    return table;
+}
+
+/**
+ * Вычисление CRC-32 (IEEE 802.3).
+ * @param data - данные.
+ * @param len - длина данных (байт).
+ * @param crc - значение для продолжения вычисления.
+ * @return - контрольная сумма.
+ */
+uint32_t crc32(const void *data, size_t len, uint32_t crc) {
+    static const std::array<uint32_t, 256> table = makeCrcTable();
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * @param v - знаковое число.
+ * @return - число в zigzag-кодировке.
+ */
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+/**
+ * @param v - число в zigzag-кодировке.
+ * @return - знаковое число.
+ */
+static inline int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/**
+ * @param v - беззнаковое число.
+ * @return - длина его varint-записи (байт).
+ */
+static inline size_t varintLen(uint32_t v) {
+    return v < (1u << 7) ? 1 : v < (1u << 14) ? 2 : v < (1u << 21) ? 3 : v < (1u << 28) ? 4 : 5;
+}
+
+/**
+ * Сжатие отсчетов: разности соседних отсчетов (первая - от нуля),
+ * сдвинутые вправо на shift бит, в zigzag-кодировке как varint.
+ * @param data - отсчеты.
+ * @param n - число отсчетов.
+ * @param shift - общий сдвиг (младшие shift бит всех отсчетов нулевые).
+ * @param out - выходной буфер (не меньше 5 * n байт).
+ * @return - длина сжатых данных (байт).
+ */
+size_t deltaEncode(const int32_t *data, size_t n, int shift, uint8_t *out) {
+    uint8_t *p = out;
+    int32_t prev = 0;
+    for (size_t i = 0; i < n; i++) {
+        int32_t v = data[i] >> shift;
+        uint32_t z = zigzag((int32_t)((uint32_t)v - (uint32_t)prev));
+        prev = v;
+        while (z >= 0x80) {
+            *p++ = (uint8_t)(z | 0x80);
+            z >>= 7;
+        }
+        *p++ = (uint8_t)z;
+    }
+    return p - out;
+}
+
+/**
+ * Восстановление отсчетов, сжатых deltaEncode().
+ * @param in - сжатые данные.
+ * @param len - их длина (байт).
+ * @param n - число отсчетов.
+ * @param shift - общий сдвиг.
+ * @param data - отсчеты.
+ * @return - совпали ли число отсчетов и длина данных.
+ */
+bool deltaDecode(const uint8_t *in, size_t len, size_t n, int shift, int32_t *data) {
+    const uint8_t *p = in, *end = in + len;
+    int32_t prev = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t z = 0;
+        for (int s = 0; ; s += 7) {
+            if (p == end || s > 28) {
+                return false;
+            }
+            uint8_t b = *p++;
+            z |= (uint32_t)(b & 0x7f) << s;
+            if (b < 0x80) {
+                break;
+            }
+        }
+        prev = (int32_t)((uint32_t)prev + (uint32_t)unzigzag(z));
+        data[i] = (int32_t)((uint32_t)prev << shift);
+    }
+    return p == end;
+}
+
+/**
+ * Конструктор записи контейнера.
+ * @param root - корневой каталог данных.
+ * @param channel - номер канала.
+ * @param oneFile - писать все данные в один файл.
+ * @param flushInterval - интервал сброса буферов на диск (сек).
+ * @param sampleRate - частота записываемых отсчетов (Гц).
+ * @param averaging - коэффициент усреднения (0 - нет).
+ * @param scale - вольт на единицу отсчета.
+ * @param chunkCodec - способ кодирования отсчетов.
+ * @param log - журнал.
+ * @param tag - добавка к имени файлов (для дополнительных выводов канала).
+ */
+ContainerWriter::ContainerWriter(std::string root, uint8_t channel, bool oneFile, uint32_t flushInterval,
+                                 double sampleRate, uint16_t averaging, double scale, uint16_t chunkCodec,
+                                 Logger *log, std::string tag) {
+    chan = channel;
+    dataInOneFile = oneFile;
+    rate = sampleRate;
+    aver = averaging;
+    voltsScale = scale;
+    codec = chunkCodec;
+    logger = log;
+    char suffix[FILE_LEN], name[FILE_LEN], indexSuffix[FILE_LEN], indexName[FILE_LEN];
+    snprintf(suffix, FILE_LEN, "_%02d%s.adc", channel, tag.c_str());
+    snprintf(name, FILE_LEN, "data_ch%d%s.adc", channel, tag.c_str());
+    snprintf(indexSuffix, FILE_LEN, "_%02d%s.adc" INDEX_SUFFIX, channel, tag.c_str());
+    snprintf(indexName, FILE_LEN, "data_ch%d%s.adc" INDEX_SUFFIX, channel, tag.c_str());
+    dataFile.reset(new RotatingFile(root, suffix, name, oneFile, flushInterval, log));
+    indexFile.reset(new RotatingFile(root, indexSuffix, indexName, oneFile, flushInterval, log));
+    samples.reserve(codec == CODEC_RAW ? CONTAINER_CHUNK_SAMPLES : CONTAINER_PAYLOAD_LEN);
+    chunk.resize(CONTAINER_CHUNK_LEN);
+}
+
+/**
+ * Деструктор. Дописывает незаполненный блок.
+ */
+ContainerWriter::~ContainerWriter() {
+    close();
+}
+
+/**
+ * Добавление отсчетов. Блок записывается, когда он заполнен, при разрыве
+ * во времени, при смене часа и не реже раза в CONTAINER_MAX_CHUNK_SPAN секунд.
+ * @param data - отсчеты.
+ * @param len - число отсчетов.
+ * @param tv - время первого отсчета.
+ * @return - код ошибки.
+ */
+int8_t ContainerWriter::write(const int32_t *data, size_t len, const struct timeval *tv) {
+    int64_t usec = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    double period = 1000000.0 / rate;
+    time_t hour = dataInOneFile ? 0 : tv->tv_sec / 3600;
+    if (!samples.empty()) {
+        int64_t expected = chunkStart + llround(samples.size() * period);
+        // Допустимое расхождение - длительность одного пакета АЦП
+        int64_t tolerance = llround(period * CHANBUF_LEN / (aver > 0 ? aver : 1));
+        if (hour != chunkHour || llabs(usec - expected) > tolerance ||
+            usec - chunkStart >= (int64_t)CONTAINER_MAX_CHUNK_SPAN * 1000000) {
+            if (sealChunk() != SUCCESS) {
+                return IO_FAILURE;
+            }
+        }
+    }
+    size_t i = 0;
+    while (i < len) {
+        if (samples.empty()) {
+            chunkStart = usec + llround(i * period);
+            chunkHour = hour;
+        }
+        if (codec == CODEC_RAW) {
+            size_t n = std::min(len - i, CONTAINER_CHUNK_SAMPLES - samples.size());
+            samples.insert(samples.end(), data + i, data + i + n);
+            i += n;
+            if (samples.size() == CONTAINER_CHUNK_SAMPLES && sealChunk() != SUCCESS) {
+                return IO_FAILURE;
+            }
+        } else if (appendDelta(data[i])) {
+            i++;
+        } else if (sealChunk() != SUCCESS) {
+            return IO_FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Добавление отсчета в сжимаемый блок с учетом длины сжатых данных.
+ * @param value - отсчет.
+ * @return - false, если сжатый отсчет не помещается в блок.
+ */
+bool ContainerWriter::appendDelta(int32_t value) {
+    uint32_t newOr = orBits | (uint32_t)value;
+    int newShift = newOr == 0 ? DELTA_MAX_SHIFT : std::min(__builtin_ctz(newOr), DELTA_MAX_SHIFT);
+    size_t len = encodedLen;
+    if (newShift != shift) {
+        // Сдвиг уменьшился - длина пересчитывается для всех отсчетов блока
+        len = 0;
+        int32_t prev = 0;
+        for (int32_t v : samples) {
+            len += varintLen(zigzag((int32_t)((uint32_t)(v >> newShift) - (uint32_t)prev)));
+            prev = v >> newShift;
+        }
+    }
+    int32_t prev = samples.empty() ? 0 : samples.back() >> newShift;
+    len += varintLen(zigzag((int32_t)((uint32_t)(value >> newShift) - (uint32_t)prev)));
+    if (len > CONTAINER_PAYLOAD_LEN && !samples.empty()) {
+        return false;
+    }
+    orBits = newOr;
+    shift = newShift;
+    encodedLen = len;
+    samples.push_back(value);
+    return true;
+}
+
+/**
+ * Запись незаполненного блока.
+ * @return - код ошибки.
+ */
+int8_t ContainerWriter::finish() {
+    if (samples.empty()) {
+        return SUCCESS;
+    }
+    return sealChunk();
+}
+
+/**
+ * Запись незаполненного блока и закрытие файлов.
+ * @return - код ошибки.
+ */
+int8_t ContainerWriter::close() {
+    int8_t res = finish();
+    if (dataFile->close() != SUCCESS) {
+        res = IO_FAILURE;
+    }
+    if (indexFile->close() != SUCCESS) {
+        res = IO_FAILURE;
+    }
+    return res;
+}
+
+/**
+ * Запись накопленных отсчетов блоком фиксированного размера и строкой индекса.
+ * @return - код ошибки.
+ */
+int8_t ContainerWriter::sealChunk() {
+    struct timeval tv;
+    tv.tv_sec = chunkStart / 1000000;
+    tv.tv_usec = chunkStart % 1000000;
+    if (tv.tv_usec < 0) {
+        tv.tv_sec--;
+        tv.tv_usec += 1000000;
+    }
+    if (dataFile->prepare(&tv) < 0 || indexFile->prepare(&tv) < 0) {
+        resetChunk();
+        return IO_FAILURE;
+    }
+    if ((dataFile->rotated() && startDataFile() != SUCCESS) ||
+        (indexFile->rotated() && startIndexFile() != SUCCESS)) {
+        resetChunk();
+        return IO_FAILURE;
+    }
+
+    ChunkHeader ch {};
+    ch.magic = CHUNK_MAGIC;
+    ch.codec = codec;
+    ch.samples = samples.size();
+    ch.startUsec = chunkStart;
+    memset(chunk.data(), 0, chunk.size());
+    if (codec == CODEC_RAW) {
+        ch.payloadLen = samples.size() * sizeof(int32_t);
+        memcpy(chunk.data() + sizeof(ChunkHeader), samples.data(), ch.payloadLen);
+    } else {
+        ch.flags = shift;
+        ch.payloadLen = deltaEncode(samples.data(), samples.size(), shift, chunk.data() + sizeof(ChunkHeader));
+    }
+    ch.crc = crc32(&ch, offsetof(ChunkHeader, crc));
+    ch.crc = crc32(chunk.data() + sizeof(ChunkHeader), ch.payloadLen, ch.crc);
+    memcpy(chunk.data(), &ch, sizeof(ChunkHeader));
+    resetChunk();
+
+    IndexEntry entry;
+    entry.startUsec = chunkStart;
+    entry.offset = dataFile->size();
+    if (dataFile->write(chunk.data(), chunk.size()) < 0 || indexFile->write(&entry, sizeof(entry)) < 0) {
+        logger->logging(ERROR, "Cannot write container chunk");
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Очистка накопленных отсчетов блока.
+ */
+void ContainerWriter::resetChunk() {
+    samples.clear();
+    orBits = 0;
+    shift = DELTA_MAX_SHIFT;
+    encodedLen = 0;
+}
+
+/**
+ * Подготовка открытого файла данных: запись заголовка в новый файл
+ * или выравнивание дозаписываемого файла по границе блока.
+ * @return - код ошибки.
+ */
+int8_t ContainerWriter::startDataFile() {
+    long size = dataFile->size();
+    if (size < 0) {
+        return IO_FAILURE;
+    }
+    if (size == 0) {
+        ContainerHeader hdr {};
+        memcpy(hdr.magic, CONTAINER_MAGIC, sizeof(hdr.magic));
+        hdr.version = CONTAINER_VERSION;
+        hdr.headerLen = sizeof(ContainerHeader);
+        hdr.chunkLen = CONTAINER_CHUNK_LEN;
+        hdr.channel = chan;
+        hdr.codec = codec;
+        hdr.averaging = aver;
+        hdr.sampleRate = rate;
+        hdr.scale = voltsScale;
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        hdr.created = (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+        hdr.crc = crc32(&hdr, offsetof(ContainerHeader, crc));
+        return dataFile->write(&hdr, sizeof(hdr));
+    }
+    // Недописанный при аварийном завершении блок заполняется нулями
+    long tail = (size - (long)sizeof(ContainerHeader)) % CONTAINER_CHUNK_LEN;
+    if (tail != 0) {
+        std::vector<uint8_t> pad(CONTAINER_CHUNK_LEN - tail, 0);
+        return dataFile->write(pad.data(), pad.size());
+    }
+    return SUCCESS;
+}
+
+/**
+ * Подготовка открытого файла индекса: запись заголовка в новый файл
+ * или отбрасывание недописанной строки дозаписываемого файла.
+ * @return - код ошибки.
+ */
+int8_t ContainerWriter::startIndexFile() {
+    long size = indexFile->size();
+    if (size < 0) {
+        return IO_FAILURE;
+    }
+    if (size == 0) {
+        uint8_t hdr[sizeof(IndexEntry)] = {0};
+        memcpy(hdr, INDEX_MAGIC, 8);
+        uint32_t version = CONTAINER_VERSION, chunkLen = CONTAINER_CHUNK_LEN;
+        memcpy(hdr + 8, &version, 4);
+        memcpy(hdr + 12, &chunkLen, 4);
+        return indexFile->write(hdr, sizeof(hdr));
+    }
+    long tail = size % sizeof(IndexEntry);
+    if (tail != 0) {
+        // Строка с нулевым смещением считается пустой
+        std::vector<uint8_t> pad(sizeof(IndexEntry) - tail, 0);
+        return indexFile->write(pad.data(), pad.size());
+    }
+    return SUCCESS;
+}
+
+/**
+ * Конструктор чтения контейнера.
+ */
+ContainerReader::ContainerReader() {
+    chunk.resize(CONTAINER_CHUNK_LEN);
+}
+
+/**
+ * Деструктор. Закрывает файлы.
+ */
+ContainerReader::~ContainerReader() {
+    close();
+}
+
+/**
+ * Открытие контейнера и его индекса, если он есть.
+ * @param fileName - имя файла контейнера.
+ * @return - код ошибки.
+ */
+int8_t ContainerReader::open(const std::string &fileName) {
+    close();
+    fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return IO_FAILURE;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+        memcmp(hdr.magic, CONTAINER_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.crc != crc32(&hdr, offsetof(ContainerHeader, crc)) ||
+        hdr.version != CONTAINER_VERSION || hdr.chunkLen < sizeof(ChunkHeader)) {
+        close();
+        return IO_FAILURE;
+    }
+    chunk.resize(hdr.chunkLen);
+    chunkCount = (st.st_size - hdr.headerLen) / hdr.chunkLen;
+
+    // Индекс используется, только если он описывает все блоки
+    indexFd = ::open((fileName + INDEX_SUFFIX).c_str(), O_RDONLY);
+    if (indexFd >= 0) {
+        char magic[8];
+        indexCount = fstat(indexFd, &st) == 0 ? st.st_size / sizeof(IndexEntry) : 0;
+        if (indexCount == 0 || pread(indexFd, magic, 8, 0) != 8 || memcmp(magic, INDEX_MAGIC, 8) != 0 ||
+            indexCount - 1 != chunkCount) {
+            ::close(indexFd);
+            indexFd = -1;
+        }
+        indexCount = indexFd >= 0 ? indexCount - 1 : 0;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Закрытие файлов.
+ */
+void ContainerReader::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    if (indexFd >= 0) {
+        ::close(indexFd);
+        indexFd = -1;
+    }
+    chunkCount = 0;
+    indexCount = 0;
+}
+
+/**
+ * @return - заголовок файла.
+ */
+const ContainerHeader &ContainerReader::header() {
+    return hdr;
+}
+
+/**
+ * @return - число блоков в файле.
+ */
+size_t ContainerReader::chunks() {
+    return chunkCount;
+}
+
+/**
+ * Поиск блока, содержащего заданное время, двоичным поиском.
+ * @param usec - время (мкс от начала эпохи).
+ * @return - номер последнего блока, начинающегося не позже usec (0, если таких нет).
+ */
+size_t ContainerReader::seek(int64_t usec) {
+    size_t lo = 0, hi = chunkCount;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        int64_t start;
+        // Поврежденные блоки пропускаются вперед
+        size_t probe = mid;
+        while (probe < hi && !chunkStart(probe, &start)) {
+            probe++;
+        }
+        if (probe == hi || start > usec) {
+            hi = mid;
+        } else {
+            lo = probe;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Чтение и проверка блока.
+ * @param n - номер блока.
+ * @param data - отсчеты блока.
+ * @param startUsec - время первого отсчета.
+ * @return - код ошибки.
+ */
+int8_t ContainerReader::readChunk(size_t n, std::vector<int32_t> *data, int64_t *startUsec) {
+    if (n >= chunkCount) {
+        return IO_FAILURE;
+    }
+    off_t offset = hdr.headerLen + (off_t)n * hdr.chunkLen;
+    if (pread(fd, chunk.data(), hdr.chunkLen, offset) != (ssize_t)hdr.chunkLen) {
+        return IO_FAILURE;
+    }
+    ChunkHeader ch;
+    memcpy(&ch, chunk.data(), sizeof(ch));
+    if (ch.magic != CHUNK_MAGIC || ch.payloadLen > hdr.chunkLen - sizeof(ChunkHeader)) {
+        return IO_FAILURE;
+    }
+    uint32_t crc = crc32(&ch, offsetof(ChunkHeader, crc));
+    if (crc32(chunk.data() + sizeof(ChunkHeader), ch.payloadLen, crc) != ch.crc) {
+        return IO_FAILURE;
+    }
+    data->resize(ch.samples);
+    const uint8_t *payload = chunk.data() + sizeof(ChunkHeader);
+    if (ch.codec == CODEC_RAW && ch.payloadLen == ch.samples * sizeof(int32_t)) {
+        memcpy(data->data(), payload, ch.payloadLen);
+    } else if (ch.codec == CODEC_DELTA_VARINT && (ch.flags & 0xff) <= DELTA_MAX_SHIFT) {
+        if (!deltaDecode(payload, ch.payloadLen, ch.samples, ch.flags & 0xff, data->data())) {
+            return IO_FAILURE;
+        }
+    } else {
+        return IO_FAILURE;
+    }
+    *startUsec = ch.startUsec;
+    return SUCCESS;
+}
+
+/**
+ * Время начала блока по индексу или по заголовку блока.
+ * @param n - номер блока.
+ * @param usec - время первого отсчета.
+ * @return - удалось ли получить время.
+ */
+bool ContainerReader::chunkStart(size_t n, int64_t *usec) {
+    if (indexFd >= 0) {
+        IndexEntry entry;
+        if (pread(indexFd, &entry, sizeof(entry), (off_t)(n + 1) * sizeof(entry)) == (ssize_t)sizeof(entry) &&
+            entry.offset == (int64_t)(hdr.headerLen + n * hdr.chunkLen)) {
+            *usec = entry.startUsec;
+            return true;
+        }
+    }
+    ChunkHeader ch;
+    if (pread(fd, &ch, sizeof(ch), hdr.headerLen + (off_t)n * hdr.chunkLen) != (ssize_t)sizeof(ch) ||
+        ch.magic != CHUNK_MAGIC) {
+        return false;
+    }
+    *usec = ch.startUsec;
+    return true;
+}
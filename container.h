@@ -0,0 +1,182 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_CONTAINER_H
+#define ADCCOLLECTOR_CONTAINER_H
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <sys/time.h>
+#include "adcdefs.h"
+#include "logger.h"
+#include "rotatingfile.h"
+
+// Container file signature and version
+#define CONTAINER_MAGIC "ADCCHUNK"
+#define CONTAINER_VERSION 1
+// Sidecar index signature (<data file>.idx)
+#define INDEX_MAGIC "ADCINDEX"
+#define INDEX_SUFFIX ".idx"
+// Fixed chunk size (bytes) including the chunk header
+#define CONTAINER_CHUNK_LEN 4096
+// Chunk signature ("ADCK")
+#define CHUNK_MAGIC 0x4b434441
+// Samples of a raw int32 chunk
+#define CONTAINER_CHUNK_SAMPLES ((CONTAINER_CHUNK_LEN - sizeof(ChunkHeader)) / sizeof(int32_t))
+// Payload capacity of a chunk (bytes)
+#define CONTAINER_PAYLOAD_LEN (CONTAINER_CHUNK_LEN - sizeof(ChunkHeader))
+// Largest common shift of delta coded samples (ADC samples have 8 zero low bits)
+#define DELTA_MAX_SHIFT 8
+// A chunk is sealed when it spans more than this (sec), so low rates still reach the disk
+#define CONTAINER_MAX_CHUNK_SPAN 60
+
+/**
+ * Способы кодирования отсчетов в блоке.
+ */
+enum chunkCodecs {
+    CODEC_RAW = 0,
+    CODEC_DELTA_VARINT = 1
+};
+
+/**
+ * Заголовок файла контейнера (64 байта).
+ */
+struct ContainerHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t headerLen;
+    uint32_t chunkLen;
+    uint8_t channel;
+    uint8_t codec;
+    uint16_t averaging;
+    uint32_t reserved1;
+    double sampleRate;
+    double scale;
+    int64_t created;
+    uint8_t reserved2[12];
+    uint32_t crc;
+};
+
+/**
+ * Заголовок блока (32 байта). Блоки имеют фиксированный размер CONTAINER_CHUNK_LEN,
+ * отсчеты блока идут непрерывно с частотой файла начиная с startUsec.
+ * Контрольная сумма считается по заголовку без поля crc и по данным.
+ * Для CODEC_DELTA_VARINT младший байт flags - общий сдвиг отсчетов вправо.
+ */
+struct ChunkHeader {
+    uint32_t magic;
+    uint16_t codec;
+    uint16_t samples;
+    int64_t startUsec;
+    uint32_t payloadLen;
+    uint32_t flags;
+    uint32_t reserved;
+    uint32_t crc;
+};
+
+/**
+ * Запись индекса: время первого отсчета блока и смещение блока в файле.
+ */
+struct IndexEntry {
+    int64_t startUsec;
+    int64_t offset;
+};
+
+static_assert(sizeof(ContainerHeader) == 64, "container header must be 64 bytes");
+static_assert(sizeof(ChunkHeader) == 32, "chunk header must be 32 bytes");
+static_assert(sizeof(IndexEntry) == 16, "index entry must be 16 bytes");
+
+uint32_t crc32(const void *data, size_t len, uint32_t crc = 0);
+size_t deltaEncode(const int32_t *data, size_t n, int shift, uint8_t *out);
+bool deltaDecode(const uint8_t *in, size_t len, size_t n, int shift, int32_t *data);
+
+/**
+ * Запись данных канала в контейнер: заголовок файла с параметрами канала,
+ * затем блоки фиксированного размера с контрольной суммой. Отсчеты блока
+ * хранятся как есть или сжатыми без потерь: разности соседних отсчетов
+ * в zigzag-кодировке, записанные как varint. Одновременно
+ * ведется индекс (<файл>.idx) с временем и смещением каждого блока.
+ * Файлы делятся по часам так же, как остальные файлы данных.
+ */
+class ContainerWriter {
+public:
+    ContainerWriter(std::string root, uint8_t channel, bool oneFile, uint32_t flushInterval,
+                    double sampleRate, uint16_t averaging, double scale, uint16_t chunkCodec, Logger *log,
+                    std::string tag = "");
+    ~ContainerWriter();
+
+    int8_t write(const int32_t *data, size_t len, const struct timeval *tv);
+    int8_t finish();
+    int8_t close();
+
+private:
+    uint8_t chan;
+    bool dataInOneFile;
+    double rate;
+    uint16_t aver;
+    double voltsScale;
+    uint16_t codec;
+    Logger *logger;
+    std::unique_ptr<RotatingFile> dataFile;
+    std::unique_ptr<RotatingFile> indexFile;
+
+    std::vector<int32_t> samples;
+    int64_t chunkStart = 0;
+    time_t chunkHour = 0;
+    std::vector<uint8_t> chunk;
+    uint32_t orBits = 0;
+    int shift = DELTA_MAX_SHIFT;
+    size_t encodedLen = 0;
+
+    bool appendDelta(int32_t value);
+    int8_t sealChunk();
+    void resetChunk();
+    int8_t startDataFile();
+    int8_t startIndexFile();
+};
+
+/**
+ * Чтение контейнера с поиском блока по времени за O(log n):
+ * по индексу, если он есть, иначе по заголовкам блоков.
+ */
+class ContainerReader {
+public:
+    ContainerReader();
+    ~ContainerReader();
+
+    int8_t open(const std::string &fileName);
+    void close();
+    const ContainerHeader &header();
+    size_t chunks();
+    size_t seek(int64_t usec);
+    int8_t readChunk(size_t n, std::vector<int32_t> *data, int64_t *startUsec);
+
+private:
+    int fd = -1;
+    int indexFd = -1;
+    ContainerHeader hdr {};
+    size_t chunkCount = 0;
+    size_t indexCount = 0;
+    std::vector<uint8_t> chunk;
+
+    bool chunkStart(size_t n, int64_t *usec);
+};
+
+
+#endif //ADCCOLLECTOR_CONTAINER_H
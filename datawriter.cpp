@@ -0,0 +1,409 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "datawriter.h"
+#include <unistd.h>
+#include <cstring>
+
+/**
+ * Конструктор потока записи данных. Основные выводы канала (бинарные
+ * и текстовые данные) задаются общими настройками, дополнительные -
+ * строкой выводов канала. Выводы с одинаковой частотой и фильтром
+ * объединяются в ветвь, поэтому частота понижается один раз на ветвь.
+ * @param globalView - глобальные настройки.
+ * @param channelsSets - настройки каналов.
+ * @param log - журнал.
+ */
+DataWriter::DataWriter(GlobalView globalView, std::vector<ChannelView> channelsSets, Logger *log) : ring(WRITER_RING_LEN) {
+    glView = globalView;
+    chSets = channelsSets;
+    dataRoot = glView.dataRoot.toStdString();
+    logger = log;
+    for (uint8_t i = 0; i < NUM_CHANNELS; i++) {
+        const ChannelView &chv = chSets.at(i);
+        bool binary = false;
+        if (chv.enabled) {
+            int factor = glView.meaningDataBuffer > 0 ? glView.meaningDataBuffer : 1;
+            if (chv.saveBinaryData) {
+                binary |= addOutput(i, {chv.binaryFormat, factor, chv.decimationFilter}, true);
+            }
+            if (chv.saveTextData) {
+                addOutput(i, {OUTPUT_TEXT, factor, chv.decimationFilter}, true);
+            }
+            std::vector<OutputSpec> extra;
+            if (!parseOutputSpecs(chv.extraOutputs.toStdString(), &extra)) {
+                char msg[128];
+                snprintf(msg, 128, "Cannot parse extra outputs of channel %d", i);
+                logger->logging(WARN, msg);
+            }
+            for (const OutputSpec &spec : extra) {
+                if (addOutput(i, spec, false) && spec.format != OUTPUT_TEXT) {
+                    binary = true;
+                }
+            }
+        }
+        // Обзорная пирамида строится по исходным отсчетам, если канал пишет бинарные данные
+        pyramids.emplace_back(binary ? new PyramidWriter(dataRoot, i, glView.flushInterval, glView.frequency,
+                                                         VOLTS_SCALE, logger)
+                                     : nullptr);
+    }
+}
+
+/**
+ * Добавление вывода канала в ветвь с той же частотой и фильтром.
+ * Файлы дополнительных выводов отличаются добавкой _d<коэффициент>
+ * (_m<коэффициент> для усреднения по блоку).
+ * @param chan_num - номер канала.
+ * @param spec - вывод.
+ * @param primary - основной вывод канала (имена файлов без добавки).
+ * @return - false, если такой вывод уже есть.
+ */
+bool DataWriter::addOutput(uint8_t chan_num, OutputSpec spec, bool primary) {
+    if (spec.factor <= 1) {
+        spec.factor = 1;
+        spec.filter = DECIMATION_MEAN;
+    } else if (spec.filter == DECIMATION_MEAN && CHANBUF_LEN % spec.factor != 0) {
+        spec.filter = DECIMATION_CIC_FIR;
+    }
+    std::string tag;
+    if (!primary) {
+        tag = (spec.filter == DECIMATION_MEAN && spec.factor > 1 ? "_m" : "_d") + std::to_string(spec.factor);
+    }
+
+    OutputBranch *branch = nullptr;
+    for (auto &b : branches) {
+        if (b->channel == chan_num && b->factor == spec.factor && b->filter == spec.filter) {
+            branch = b.get();
+        }
+    }
+    if (branch == nullptr) {
+        branch = new OutputBranch;
+        branch->channel = chan_num;
+        branch->factor = spec.factor;
+        branch->filter = spec.filter;
+        if (spec.factor > 1 && spec.filter == DECIMATION_CIC_FIR) {
+            branch->decimator.reset(new Decimator(spec.factor, glView.frequency));
+        }
+        branches.emplace_back(branch);
+    }
+
+    // Контейнер со сжатием и без пишется в файлы с одинаковыми именами
+    bool containerOut = spec.format == BINARY_CONTAINER || spec.format == BINARY_COMPRESSED;
+    for (auto &sink : branch->sinks) {
+        bool sameKind = sink->format == spec.format ||
+                        (containerOut && (sink->format == BINARY_CONTAINER || sink->format == BINARY_COMPRESSED));
+        if (sameKind && sink->tag == tag) {
+            char msg[128];
+            snprintf(msg, 128, "Channel %d: duplicate output %s is ignored", chan_num, outputSpecName(spec).c_str());
+            logger->logging(WARN, msg);
+            return false;
+        }
+    }
+    branch->sinks.emplace_back(createSink(chan_num, spec, tag));
+    return true;
+}
+
+/**
+ * Создание файлов вывода канала.
+ * @param chan_num - номер канала.
+ * @param spec - вывод.
+ * @param tag - добавка к именам файлов.
+ * @return - вывод канала.
+ */
+OutputSink *DataWriter::createSink(uint8_t chan_num, const OutputSpec &spec, const std::string &tag) {
+    OutputSink *sink = new OutputSink;
+    sink->format = spec.format;
+    sink->tag = tag;
+    uint16_t aver = spec.factor > 1 ? spec.factor : 0;
+    char suffix[FILE_LEN], name[FILE_LEN];
+    switch (spec.format) {
+        case OUTPUT_TEXT:
+            snprintf(suffix, FILE_LEN, "_%02d%s.txt", chan_num, tag.c_str());
+            snprintf(name, FILE_LEN, "data_ch%d%s.txt", chan_num, tag.c_str());
+            sink->file.reset(new RotatingFile(dataRoot, suffix, name, glView.dataInOneFile, glView.flushInterval,
+                                              logger));
+            sink->encoder.reset(new TextEncoder);
+            sink->encoder->setTiming(glView.frequency, aver, glView.textTimePrecision);
+            break;
+        case BINARY_CONTAINER:
+        case BINARY_COMPRESSED:
+            sink->container.reset(new ContainerWriter(dataRoot, chan_num, glView.dataInOneFile, glView.flushInterval,
+                                                      (double)glView.frequency / spec.factor, aver, VOLTS_SCALE,
+                                                      spec.format == BINARY_COMPRESSED ? CODEC_DELTA_VARINT
+                                                                                       : CODEC_RAW,
+                                                      logger, tag));
+            break;
+        case BINARY_MSEED:
+            sink->mseed.reset(new MseedWriter(dataRoot, chan_num, glView.dataInOneFile, glView.flushInterval,
+                                              glView.frequency, aver, glView.mseedRecordLen,
+                                              glView.mseedNetwork.toStdString(), glView.mseedStation.toStdString(),
+                                              logger, tag));
+            break;
+        default:
+            sink->format = BINARY_BLOCKS;
+            snprintf(suffix, FILE_LEN, ".%02d%s", chan_num, tag.c_str());
+            snprintf(name, FILE_LEN, "data_ch%d%s.dat", chan_num, tag.c_str());
+            sink->file.reset(new RotatingFile(dataRoot, suffix, name, glView.dataInOneFile, glView.flushInterval,
+                                              logger));
+            break;
+    }
+    return sink;
+}
+
+/**
+ * Деструктор. Дописывает оставшиеся блоки и останавливает поток.
+ */
+DataWriter::~DataWriter() {
+    stop();
+}
+
+/**
+ * Запуск потока записи.
+ */
+void DataWriter::start() {
+    failure = false;
+    running = true;
+    writerThread = std::thread(&DataWriter::writerLoop, this);
+}
+
+/**
+ * Остановка потока записи. Блоки, уже находящиеся в буфере, записываются.
+ * Ошибка при дописывании буферов и закрытии файлов отмечается как сбой записи.
+ */
+void DataWriter::stop() {
+    running = false;
+    if(writerThread.joinable()) {
+        writerThread.join();
+    }
+    int8_t res = SUCCESS;
+    for (auto &branch : branches) {
+        for (auto &sink : branch->sinks) {
+            if (sink->file && sink->file->close() != SUCCESS) {
+                res = IO_FAILURE;
+            }
+            if (sink->container && sink->container->close() != SUCCESS) {
+                res = IO_FAILURE;
+            }
+            if (sink->mseed && sink->mseed->close() != SUCCESS) {
+                res = IO_FAILURE;
+            }
+        }
+    }
+    for (auto &pyramid : pyramids) {
+        if (pyramid && pyramid->close() != SUCCESS) {
+            res = IO_FAILURE;
+        }
+    }
+    if (res != SUCCESS) {
+        failure = true;
+    }
+}
+
+/**
+ * Передача блока на запись (вызывается из потока сбора данных).
+ * @param block - блок данных.
+ * @return - false, если буфер заполнен и блок отброшен.
+ */
+bool DataWriter::push(const DataBlock &block) {
+    return ring.push(block);
+}
+
+/**
+ * @return - произошла ли ошибка записи.
+ */
+bool DataWriter::failed() {
+    return failure;
+}
+
+/**
+ * @return - состояние кольцевого буфера.
+ */
+RingStats DataWriter::getRingStats() {
+    RingStats st;
+    st.fill = ring.size();
+    st.capacity = ring.capacity();
+    st.highWater = ring.highWater();
+    st.overruns = ring.overruns();
+    return st;
+}
+
+/**
+ * Основной цикл потока записи.
+ */
+void DataWriter::writerLoop() {
+    while(true) {
+        DataBlock *block = ring.front();
+        if(block == nullptr) {
+            if(!running) {
+                break;
+            }
+            usleep(WRITER_IDLE_SLEEP);
+            continue;
+        }
+        if(!failure && writeBlock(block) != SUCCESS) {
+            failure = true;
+        }
+        ring.release();
+    }
+}
+
+/**
+ * Запись блока данных всех разрешенных каналов. Отсчеты канала
+ * разбираются один раз, каждая ветвь понижает частоту отдельно.
+ * @param block - блок данных.
+ * @return - код ошибки.
+ */
+int8_t DataWriter::writeBlock(DataBlock *block) {
+    int32_t decimated[CHANBUF_LEN];
+    for (auto &branch : branches) {
+        int32_t *data = block->ch[branch->channel];
+        size_t len = CHANBUF_LEN;
+        struct timeval tv = block->tv;
+        if (branch->factor > 1) {
+            len = decimate(branch.get(), data, &block->tv, decimated, &tv);
+            data = decimated;
+        }
+        if (len == 0) {
+            continue;
+        }
+        for (auto &sink : branch->sinks) {
+            int8_t writeRes;
+            if (sink->format == OUTPUT_TEXT) {
+                writeRes = writeText(sink.get(), data, len, &tv);
+            } else {
+                writeRes = writeData(sink.get(), data, len, &tv);
+            }
+            if (writeRes < 0) {
+                return IO_FAILURE;
+            }
+        }
+    }
+    // Обзорная пирамида строится по исходным отсчетам, без усреднения
+    for (uint8_t i = 0; i < NUM_CHANNELS; i++) {
+        if (pyramids.at(i) && pyramids.at(i)->write(block->ch[i], CHANBUF_LEN, &block->tv) < 0) {
+            return IO_FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Понижение частоты отсчетов канала усреднением по блоку
+ * или потоковым фильтром, выбранным для ветви.
+ * @param branch - ветвь канала.
+ * @param chan_data - отсчеты канала (CHANBUF_LEN).
+ * @param tv - время блока.
+ * @param out - выходные отсчеты.
+ * @param outTv - время первого выходного отсчета.
+ * @return - число выходных отсчетов.
+ */
+size_t DataWriter::decimate(OutputBranch *branch, const int32_t *chan_data, const struct timeval *tv, int32_t *out,
+                            struct timeval *outTv) {
+    if (branch->decimator) {
+        return branch->decimator->process(chan_data, CHANBUF_LEN, tv, out, outTv);
+    }
+    meanChanData(chan_data, CHANBUF_LEN, out, branch->factor);
+    *outTv = *tv;
+    return CHANBUF_LEN / branch->factor;
+}
+
+/**
+ * Запись бинарных данных.
+ * @param sink - вывод канала.
+ * @param chan_data - данные каналов.
+ * @param len - длина данных каналов.
+ * @param tv - время.
+ * @return - код ошибки.
+ */
+int8_t DataWriter::writeData(OutputSink *sink, int32_t *chan_data, uint16_t len, struct timeval *tv) {
+    if (sink->container) {
+        return sink->container->write(chan_data, len, tv);
+    }
+    if (sink->mseed) {
+        return sink->mseed->write(chan_data, len, tv);
+    }
+    RotatingFile *f = sink->file.get();
+    if (f->prepare(tv) < 0) {
+        return IO_FAILURE;
+    }
+
+    // Header, timestamp and data are written with a single call
+    uint8_t block[4 + sizeof(uint64_t) + CHANBUF_LEN * sizeof(int32_t)];
+    memset(block, 0xff, 4);
+    uint64_t msec = (uint64_t)tv->tv_sec * 1000 + ((uint32_t)tv->tv_usec / 1000);
+    memcpy(block + 4, &msec, sizeof(uint64_t));
+
+    memcpy(block + 4 + sizeof(uint64_t), chan_data, len * sizeof(int32_t));
+
+    if (f->write(block, 4 + sizeof(uint64_t) + len * sizeof(int32_t)) < 0) {
+        logger->logging(ERROR, "Cannot write current data buffer to file");
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Запись данных в виде текста.
+ * @param sink - вывод канала.
+ * @param chan_data - данные каналов.
+ * @param len - длина данных каналов.
+ * @param tv - время.
+ * @return - код ошибки.
+ */
+int8_t DataWriter::writeText(OutputSink *sink, int32_t *chan_data, uint16_t len, struct timeval *tv) {
+    RotatingFile *f = sink->file.get();
+    if (f->prepare(tv) < 0) {
+        return IO_FAILURE;
+    }
+    return writeTextData(f, sink->encoder.get(), chan_data, len, tv);
+}
+
+/**
+ * Запись данных в текстовый файл. Блок целиком преобразуется в текст
+ * и записывается одним вызовом.
+ * @param f - файл данных канала.
+ * @param encoder - преобразователь в текст.
+ * @param data - буфер данных.
+ * @param len - длина буфера.
+ * @param tv - время.
+ * @return - код ошибки.
+ */
+int8_t DataWriter::writeTextData(RotatingFile *f, TextEncoder *encoder, int32_t *data, size_t len, struct timeval *tv) {
+    size_t n = encoder->encode(data, len, tv);
+    if (f->write(encoder->data(), n) < 0) {
+        logger->logging(ERROR, "Cannot write text data");
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Усреднение данных.
+ * @param chan_data - данные каналов.
+ * @param chan_size - размер данных каналов.
+ * @param mean_buf - выходной буфер.
+ * @param aver - коэффициент усреднения.
+ */
+void DataWriter::meanChanData(const int32_t *chan_data, uint8_t chan_size, int32_t *mean_buf, uint8_t aver) {
+    for (uint8_t i = 0; i < chan_size / aver; i++) {
+        int64_t sum = 0;
+        for (uint8_t j = 0; j < aver; j++) {
+            sum += chan_data[i * aver + j];
+        }
+        mean_buf[i] = (int32_t)(sum / aver);
+    }
+}
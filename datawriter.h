@@ -0,0 +1,132 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_DATAWRITER_H
+#define ADCCOLLECTOR_DATAWRITER_H
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <ctime>
+#include <sys/time.h>
+#include "adcdefs.h"
+#include "logger.h"
+#include "rotatingfile.h"
+#include "textencoder.h"
+#include "container.h"
+#include "mseedwriter.h"
+#include "pyramid.h"
+#include "decimator.h"
+#include "outputspec.h"
+#include "packetdecoder.h"
+#include "settings.h"
+#include "spscring.h"
+
+// Number of blocks in the acquisition -> storage ring
+#define WRITER_RING_LEN 1024
+// Writer idle sleep when the ring is empty (usec)
+#define WRITER_IDLE_SLEEP 2000
+
+/**
+ * Блок данных всех каналов, полученный из одного пакета АЦП.
+ * tv - время первого отсчета блока, время остальных отсчетов
+ * отсчитывается от него по частоте дискретизации.
+ */
+struct DataBlock {
+    struct timeval tv;
+    int32_t ch[NUM_CHANNELS][CHANBUF_LEN];
+};
+
+/**
+ * Состояние кольцевого буфера между потоками сбора и записи.
+ */
+struct RingStats {
+    size_t fill;
+    size_t capacity;
+    size_t highWater;
+    uint64_t overruns;
+};
+
+/**
+ * Вывод канала: файлы одного вида (см. OutputSpec).
+ */
+struct OutputSink {
+    int format;
+    std::string tag;
+    std::unique_ptr<RotatingFile> file;
+    std::unique_ptr<TextEncoder> encoder;
+    std::unique_ptr<ContainerWriter> container;
+    std::unique_ptr<MseedWriter> mseed;
+};
+
+/**
+ * Ветвь канала: выводы с одинаковой частотой и фильтром. Частота
+ * понижается один раз на блок, результат записывается всеми выводами ветви.
+ */
+struct OutputBranch {
+    uint8_t channel;
+    int factor;
+    int filter;
+    std::unique_ptr<Decimator> decimator;
+    std::vector<std::unique_ptr<OutputSink>> sinks;
+};
+
+/**
+ * Поток записи данных на диск. Забирает блоки из кольцевого буфера,
+ * который заполняет поток сбора данных, поэтому медленные операции
+ * с файлами не задерживают чтение USB.
+ */
+class DataWriter {
+public:
+    DataWriter(GlobalView globalView, std::vector<ChannelView> channelsSets, Logger *log);
+    ~DataWriter();
+
+    void start();
+    void stop();
+    bool push(const DataBlock &block);
+    bool failed();
+    RingStats getRingStats();
+
+    static void meanChanData(const int32_t *chan_data, uint8_t chan_size, int32_t *mean_buf, uint8_t aver);
+
+private:
+    GlobalView glView;
+    std::vector<ChannelView> chSets;
+    std::string dataRoot;
+    Logger *logger;
+    SpscRing<DataBlock> ring;
+    std::vector<std::unique_ptr<OutputBranch>> branches;
+    std::vector<std::unique_ptr<PyramidWriter>> pyramids;
+    std::thread writerThread;
+    std::atomic<bool> running {false};
+    std::atomic<bool> failure {false};
+
+    void writerLoop();
+    int8_t writeBlock(DataBlock *block);
+    bool addOutput(uint8_t chan_num, OutputSpec spec, bool primary);
+    OutputSink *createSink(uint8_t chan_num, const OutputSpec &spec, const std::string &tag);
+    size_t decimate(OutputBranch *branch, const int32_t *chan_data, const struct timeval *tv, int32_t *out,
+                    struct timeval *outTv);
+    int8_t writeData(OutputSink *sink, int32_t *chan_data, uint16_t len, struct timeval *tv);
+    int8_t writeText(OutputSink *sink, int32_t *chan_data, uint16_t len, struct timeval *tv);
+    int8_t writeTextData(RotatingFile *f, TextEncoder *encoder, int32_t *data, size_t len, struct timeval *tv);
+};
+
+
+#endif //ADCCOLLECTOR_DATAWRITER_H
@@ -0,0 +1,306 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "decimator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DECIMATOR_X86
+#endif
+
+// Frequency grid used to design the FIR
+#define FIR_DESIGN_GRID 4096
+
+
+#ifdef DECIMATOR_X86
+/**
+ * Скалярное произведение окна КИХ-фильтра на коэффициенты (AVX2 + FMA).
+ * @param a - коэффициенты.
+ * @param b - окно отсчетов.
+ * @param len - длина окна (кратна 8).
+ * @return - выход фильтра.
+ */
+__attribute__((target("avx2,fma")))
+static double dotAvx2(const double *a, const double *b, int len) {
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    for (int i = 0; i < len; i += 8) {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+    }
+    s0 = _mm256_add_pd(s0, s1);
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(s0), _mm256_extractf128_pd(s0, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+/**
+ * Скалярное произведение окна КИХ-фильтра на коэффициенты (SSE2).
+ * @param a - коэффициенты.
+ * @param b - окно отсчетов.
+ * @param len - длина окна (кратна 8).
+ * @return - выход фильтра.
+ */
+__attribute__((target("sse2")))
+static double dotSse2(const double *a, const double *b, int len) {
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+    for (int i = 0; i < len; i += 4) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    s0 = _mm_add_pd(s0, s1);
+    return _mm_cvtsd_f64(_mm_add_sd(s0, _mm_unpackhi_pd(s0, s0)));
+}
+#endif
+
+/**
+ * Конструктор. Расчет КИХ-фильтра и выбор векторного варианта.
+ * @param factor - коэффициент понижения частоты (2..DECIMATION_MAX_FACTOR,
+ * firFactorFor(factor) не равен 0).
+ * @param frequency - частота входных отсчетов.
+ */
+Decimator::Decimator(int factor, int frequency) {
+    total = factor;
+    firFactor = firFactorFor(factor);
+    if (firFactor == 0) {
+        // Недопустимый коэффициент: КИХ-фильтру достается наименьший делитель
+        firFactor = 2;
+        while (factor % firFactor != 0) {
+            firFactor++;
+        }
+    }
+    cicFactor = factor / firFactor;
+    firTaps = FIR_TAPS_PER_FACTOR * firFactor - 1;
+    // Окно дополняется нулевыми коэффициентами до длины, кратной 8
+    firLen = (firTaps + 8) & ~7;
+    stepUsec = 1000000.0 / frequency;
+    // Отсчеты входят в CIC без 8 младших нулевых бит
+    cicGain = 256.0 / pow(cicFactor, CIC_ORDER);
+    coef.resize(firLen);
+    designFir(cicFactor, firFactor, firTaps, coef.data(), firLen);
+    window.assign(2 * firLen, 0);
+
+    dotFn = dotScalar;
+    isa = "scalar";
+#ifdef DECIMATOR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        dotFn = dotAvx2;
+        isa = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        dotFn = dotSse2;
+        isa = "sse2";
+    }
+#endif
+}
+
+/**
+ * Фильтрация и понижение частоты блока отсчетов.
+ * @param in - входные отсчеты.
+ * @param len - число входных отсчетов.
+ * @param tv - время первого входного отсчета.
+ * @param out - выходные отсчеты (не больше len / factor + 1).
+ * @param outTv - время первого выходного отсчета.
+ * @return - число выходных отсчетов.
+ */
+size_t Decimator::process(const int32_t *in, size_t len, const struct timeval *tv, int32_t *out,
+                          struct timeval *outTv) {
+    int64_t usec = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    // Допустимое расхождение времени блоков - длительность одного блока
+    if (expectedUsec == INT64_MIN || llabs(usec - expectedUsec) > llround(len * stepUsec)) {
+        reset(in[0]);
+    }
+    expectedUsec = usec + llround(len * stepUsec);
+
+    size_t n = 0, first = 0;
+    double y;
+    for (size_t i = 0; i < len; i++) {
+        if (push(in[i], &y)) {
+            if (n == 0) {
+                first = i;
+            }
+            // Младший бит сбрасывается: 0xFFFFFFFF - маркер блока в двоичных файлах
+            double q = std::round(y / 2) * 2;
+            q = std::min(std::max(q, (double)INT32_MIN), (double)(INT32_MAX - 1));
+            out[n++] = (int32_t)q;
+        }
+    }
+
+    // Выход вычисляется по последнему отсчету группы и запаздывает на групповую задержку
+    int64_t start = usec + llround(first * stepUsec - delayUsec());
+    outTv->tv_sec = (time_t)(start / 1000000);
+    outTv->tv_usec = (suseconds_t)(start % 1000000);
+    if (outTv->tv_usec < 0) {
+        outTv->tv_sec--;
+        outTv->tv_usec += 1000000;
+    }
+    return n;
+}
+
+/**
+ * Сброс состояния: фильтры заполняются постоянным значением, чтобы
+ * после разрыва не было переходного процесса.
+ * @param value - значение отсчета.
+ */
+void Decimator::reset(int32_t value) {
+    memset(integ, 0, sizeof(integ));
+    memset(comb, 0, sizeof(comb));
+    std::fill(window.begin(), window.end(), 0);
+    cicPhase = 0;
+    firPos = 0;
+    firPhase = 0;
+    double y;
+    for (int i = 0; i < total * (firLen + CIC_ORDER); i++) {
+        push(value, &y);
+    }
+}
+
+/**
+ * @return - групповая задержка фильтров (мкс).
+ */
+double Decimator::delayUsec() {
+    return (CIC_ORDER * (cicFactor - 1) / 2.0 + cicFactor * (firTaps - 1) / 2.0) * stepUsec;
+}
+
+/**
+ * @return - название используемого набора инструкций.
+ */
+const char *Decimator::isaName() {
+    return isa;
+}
+
+/**
+ * Доля КИХ-фильтра в понижении частоты.
+ * @param factor - коэффициент понижения частоты.
+ * @return - коэффициент понижения частоты КИХ-фильтром (0, если factor
+ * больше FIR_MAX_FACTOR и не имеет делителя от FIR_MIN_FACTOR до FIR_MAX_FACTOR).
+ */
+int Decimator::firFactorFor(int factor) {
+    if (factor <= FIR_MAX_FACTOR) {
+        return factor;
+    }
+    for (int p = FIR_MIN_FACTOR; p <= FIR_MAX_FACTOR; p++) {
+        if (factor % p == 0) {
+            return p;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Расчет КИХ-фильтра методом частотной выборки с окном Блэкмана:
+ * полоса пропускания до выходной частоты Найквиста, в ней АЧХ обратна
+ * АЧХ CIC-фильтра.
+ * @param cicFactor - коэффициент понижения частоты CIC-фильтром.
+ * @param firFactor - коэффициент понижения частоты КИХ-фильтром.
+ * @param taps - число коэффициентов фильтра (нечетное).
+ * @param coef - коэффициенты окна, недостающие до len в начале нулевые.
+ * @param len - длина окна.
+ */
+void Decimator::designFir(int cicFactor, int firFactor, int taps, double *coef, int len) {
+    std::vector<double> h(taps);
+    double center = (taps - 1) / 2.0;
+    double cutoff = 0.5 / firFactor;
+    double sum = 0;
+    for (int n = 0; n < taps; n++) {
+        double m = n - center;
+        double acc = 0;
+        for (int g = 0; g <= FIR_DESIGN_GRID; g++) {
+            double f = cutoff * g / FIR_DESIGN_GRID;
+            double resp = 1;
+            if (cicFactor > 1 && g > 0) {
+                resp = pow(cicFactor * sin(M_PI * f / cicFactor) / sin(M_PI * f), CIC_ORDER);
+            }
+            acc += (g == 0 || g == FIR_DESIGN_GRID ? 0.5 : 1.0) * resp * cos(2 * M_PI * f * m);
+        }
+        double w = 0.42 - 0.5 * cos(2 * M_PI * n / (taps - 1)) + 0.08 * cos(4 * M_PI * n / (taps - 1));
+        h[n] = 2 * acc * cutoff / FIR_DESIGN_GRID * w;
+        sum += h[n];
+    }
+    // Нули стоят у самых старых отсчетов окна, центр фильтра - на (taps - 1) / 2 от нового
+    int pad = len - taps;
+    for (int n = 0; n < pad; n++) {
+        coef[n] = 0;
+    }
+    for (int n = 0; n < taps; n++) {
+        coef[pad + n] = h[n] / sum;
+    }
+}
+
+/**
+ * Добавление входного отсчета.
+ * @param x - отсчет.
+ * @param y - выходной отсчет, если он получен.
+ * @return - получен ли выходной отсчет.
+ */
+bool Decimator::push(int32_t x, double *y) {
+    if (cicFactor == 1) {
+        return pushFir(x, y);
+    }
+    // Целочисленный CIC: переполнение интеграторов компенсируется гребенчатыми звеньями
+    uint64_t v = (uint64_t)(int64_t)(x >> 8);
+    for (int j = 0; j < CIC_ORDER; j++) {
+        integ[j] += v;
+        v = integ[j];
+    }
+    if (++cicPhase < cicFactor) {
+        return false;
+    }
+    cicPhase = 0;
+    for (int j = 0; j < CIC_ORDER; j++) {
+        uint64_t t = v;
+        v -= comb[j];
+        comb[j] = t;
+    }
+    return pushFir((double)(int64_t)v * cicGain, y);
+}
+
+/**
+ * Добавление отсчета в КИХ-фильтр. Окно хранится дважды подряд,
+ * поэтому последние firLen отсчетов всегда лежат непрерывно.
+ * @param x - отсчет на выходе CIC-фильтра.
+ * @param y - выходной отсчет, если он получен.
+ * @return - получен ли выходной отсчет.
+ */
+bool Decimator::pushFir(double x, double *y) {
+    window[firPos] = x;
+    window[firPos + firLen] = x;
+    firPos = (firPos + 1) % firLen;
+    if (++firPhase < firFactor) {
+        return false;
+    }
+    firPhase = 0;
+    *y = dotFn(coef.data(), window.data() + firPos, firLen);
+    return true;
+}
+
+/**
+ * Скалярное произведение окна КИХ-фильтра на коэффициенты.
+ * @param a - коэффициенты.
+ * @param b - окно отсчетов.
+ * @param len - длина окна.
+ * @return - выход фильтра.
+ */
+double Decimator::dotScalar(const double *a, const double *b, int len) {
+    double s = 0;
+    for (int i = 0; i < len; i++) {
+        s += a[i] * b[i];
+    }
+    return s;
+}
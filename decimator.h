@@ -0,0 +1,91 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_DECIMATOR_H
+#define ADCCOLLECTOR_DECIMATOR_H
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <sys/time.h>
+#include "adcdefs.h"
+
+// Order of the CIC stage
+#define CIC_ORDER 4
+// FIR taps per unit of FIR decimation (taps = FIR_TAPS_PER_FACTOR * factor - 1)
+#define FIR_TAPS_PER_FACTOR 32
+// Range of the FIR share of the decimation; factors up to FIR_MAX_FACTOR are FIR-only
+#define FIR_MIN_FACTOR 4
+#define FIR_MAX_FACTOR 16
+// Largest decimation factor: CIC registers hold 24-bit samples with CIC_ORDER * log2(factor / 4) bits of growth
+#define DECIMATION_MAX_FACTOR 1600
+
+/**
+ * Потоковое понижение частоты отсчетов одного канала в factor раз.
+ * При factor до FIR_MAX_FACTOR используется только КИХ-фильтр, иначе
+ * CIC-фильтр 4-го порядка понижает частоту в factor/p раз (p - наименьший
+ * делитель factor от FIR_MIN_FACTOR до FIR_MAX_FACTOR), затем КИХ-фильтр
+ * с коррекцией спада АЧХ CIC понижает ее еще в p раз. Так полосы, которые
+ * CIC-фильтр наложил бы на полосу до 0.4 выходной частоты, лежат у нулей
+ * его АЧХ. Неравномерность в полосе до 0.4 выходной частоты - менее 0.01 дБ,
+ * подавление наложения в эту полосу - не менее 70 дБ (окно Блэкмана КИХ-фильтра).
+ * Состояние фильтров переносится между блоками,
+ * поэтому блок может дать любое число выходных отсчетов, в том числе ни одного.
+ * При разрыве во времени фильтры заполняются первым отсчетом нового участка.
+ * Время выходных отсчетов учитывает групповую задержку фильтров.
+ */
+class Decimator {
+public:
+    Decimator(int factor, int frequency);
+
+    size_t process(const int32_t *in, size_t len, const struct timeval *tv, int32_t *out, struct timeval *outTv);
+    void reset(int32_t value);
+    double delayUsec();
+    const char *isaName();
+
+    static int firFactorFor(int factor);
+    static void designFir(int cicFactor, int firFactor, int taps, double *coef, int len);
+
+private:
+    typedef double (*DotFn)(const double *, const double *, int);
+
+    int total;
+    int cicFactor;
+    int firFactor;
+    int firTaps;
+    int firLen;
+    double stepUsec;
+    double cicGain;
+    int64_t expectedUsec = INT64_MIN;
+
+    uint64_t integ[CIC_ORDER] = {0};
+    uint64_t comb[CIC_ORDER] = {0};
+    int cicPhase = 0;
+
+    std::vector<double> coef;
+    std::vector<double> window;
+    int firPos = 0;
+    int firPhase = 0;
+    DotFn dotFn;
+    const char *isa;
+
+    bool push(int32_t x, double *y);
+    bool pushFir(double x, double *y);
+    static double dotScalar(const double *a, const double *b, int len);
+};
+
+
+#endif //ADCCOLLECTOR_DECIMATOR_H
@@ -22,8 +22,10 @@
  * @param name - имя селектора каталогов.
  * @param path - текущий путь, который будет содержать селектор.
  * @param parent - указатель на дочерний виджет.
+ * @param selectFile - выбирать файл вместо каталога.
  */
-DirectorySelector::DirectorySelector(QString name, QString path, QWidget *parent) : QWidget(parent) {
+DirectorySelector::DirectorySelector(QString name, QString path, QWidget *parent, bool selectFile) : QWidget(parent) {
+    fileMode = selectFile;
     this->name = new QLabel(name, this);
     selectDirectoryBtn = new QToolButton(this);
     selectDirectoryBtn->setText("...");
@@ -45,8 +47,8 @@ DirectorySelector::DirectorySelector(QString name, QString path, QWidget *parent
  * @param str - текущий введенный путь до каталога.
  */
 void DirectorySelector::slotCheckDirectoryPath(const QString &str) {
-    QDir directory(str);
-    if(directory.exists()) {
+    bool exists = fileMode ? QFileInfo(str).isFile() : QDir(str).exists();
+    if(exists) {
         directoryPath->setStyleSheet("");
         path = str;
     } else {
@@ -59,7 +61,8 @@ void DirectorySelector::slotCheckDirectoryPath(const QString &str) {
  * Слот для кнопки выбора каталога.
  */
 void DirectorySelector::slotSelectDirectory() {
-    QString directory = QFileDialog::getExistingDirectory(this, tr("Selecting directory"));
+    QString directory = fileMode ? QFileDialog::getOpenFileName(this, tr("Selecting file"))
+                                 : QFileDialog::getExistingDirectory(this, tr("Selecting directory"));
     if(!directory.isEmpty()) {
         directoryPath->setText(directory);
     }
@@ -24,16 +24,18 @@
 #include <QBoxLayout>
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
 #include <QFileDialog>
 
 /**
  * Селектор каталогов.
- * Виджет, позволяющий выбрать каталог для записи данных.
+ * Виджет, позволяющий выбрать каталог для записи данных
+ * или, в режиме выбора файла, существующий файл.
  */
 class DirectorySelector : public QWidget {
 Q_OBJECT
 public:
-    explicit DirectorySelector(QString name, QString path, QWidget *parent = nullptr);
+    explicit DirectorySelector(QString name, QString path, QWidget *parent = nullptr, bool selectFile = false);
     QString getDirectoryPath();
 
 private:
@@ -42,6 +44,7 @@ private:
     QLineEdit *directoryPath;
     QHBoxLayout *labels;
     QString path;
+    bool fileMode;
 
 private slots:
     void slotCheckDirectoryPath(const QString &str);
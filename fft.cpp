@@ -0,0 +1,205 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fft.h"
+#include <cmath>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FFT_X86
+#endif
+
+/**
+ * Этап преобразования: бабочки блоков длины 2 * half.
+ * @param re - действительные части.
+ * @param im - мнимые части.
+ * @param wr - действительные части поворачивающих множителей этапа.
+ * @param wi - мнимые части поворачивающих множителей этапа.
+ * @param n - длина массивов.
+ * @param half - половина длины блока.
+ */
+static void stageScalar(float *re, float *im, const float *wr, const float *wi, size_t n, size_t half) {
+    for (size_t s = 0; s < n; s += 2 * half) {
+        for (size_t j = 0; j < half; j++) {
+            size_t a = s + j;
+            size_t b = a + half;
+            float tr = re[b] * wr[j] - im[b] * wi[j];
+            float ti = re[b] * wi[j] + im[b] * wr[j];
+            re[b] = re[a] - tr;
+            im[b] = im[a] - ti;
+            re[a] += tr;
+            im[a] += ti;
+        }
+    }
+}
+
+#ifdef FFT_X86
+/**
+ * Этап преобразования (AVX2): по 8 бабочек за итерацию.
+ */
+__attribute__((target("avx2")))
+static void stageAvx2(float *re, float *im, const float *wr, const float *wi, size_t n, size_t half) {
+    if (half < 8) {
+        stageScalar(re, im, wr, wi, n, half);
+        return;
+    }
+    for (size_t s = 0; s < n; s += 2 * half) {
+        for (size_t j = 0; j < half; j += 8) {
+            size_t a = s + j;
+            size_t b = a + half;
+            __m256 cr = _mm256_loadu_ps(wr + j);
+            __m256 ci = _mm256_loadu_ps(wi + j);
+            __m256 br = _mm256_loadu_ps(re + b);
+            __m256 bi = _mm256_loadu_ps(im + b);
+            __m256 ar = _mm256_loadu_ps(re + a);
+            __m256 ai = _mm256_loadu_ps(im + a);
+            __m256 tr = _mm256_sub_ps(_mm256_mul_ps(br, cr), _mm256_mul_ps(bi, ci));
+            __m256 ti = _mm256_add_ps(_mm256_mul_ps(br, ci), _mm256_mul_ps(bi, cr));
+            _mm256_storeu_ps(re + b, _mm256_sub_ps(ar, tr));
+            _mm256_storeu_ps(im + b, _mm256_sub_ps(ai, ti));
+            _mm256_storeu_ps(re + a, _mm256_add_ps(ar, tr));
+            _mm256_storeu_ps(im + a, _mm256_add_ps(ai, ti));
+        }
+    }
+}
+
+/**
+ * Этап преобразования (SSE2): по 4 бабочки за итерацию.
+ */
+__attribute__((target("sse2")))
+static void stageSse2(float *re, float *im, const float *wr, const float *wi, size_t n, size_t half) {
+    if (half < 4) {
+        stageScalar(re, im, wr, wi, n, half);
+        return;
+    }
+    for (size_t s = 0; s < n; s += 2 * half) {
+        for (size_t j = 0; j < half; j += 4) {
+            size_t a = s + j;
+            size_t b = a + half;
+            __m128 cr = _mm_loadu_ps(wr + j);
+            __m128 ci = _mm_loadu_ps(wi + j);
+            __m128 br = _mm_loadu_ps(re + b);
+            __m128 bi = _mm_loadu_ps(im + b);
+            __m128 ar = _mm_loadu_ps(re + a);
+            __m128 ai = _mm_loadu_ps(im + a);
+            __m128 tr = _mm_sub_ps(_mm_mul_ps(br, cr), _mm_mul_ps(bi, ci));
+            __m128 ti = _mm_add_ps(_mm_mul_ps(br, ci), _mm_mul_ps(bi, cr));
+            _mm_storeu_ps(re + b, _mm_sub_ps(ar, tr));
+            _mm_storeu_ps(im + b, _mm_sub_ps(ai, ti));
+            _mm_storeu_ps(re + a, _mm_add_ps(ar, tr));
+            _mm_storeu_ps(im + a, _mm_add_ps(ai, ti));
+        }
+    }
+}
+#endif
+
+/**
+ * Конструктор. Вычисляет перестановку и поворачивающие множители.
+ * @param length - длина сигнала (степень двойки, не меньше 4).
+ */
+RealFft::RealFft(size_t length) {
+    len = length;
+    half = length / 2;
+    size_t bits = 0;
+    while (((size_t)1 << bits) < half) {
+        bits++;
+    }
+    reversed.resize(half);
+    for (size_t i = 0; i < half; i++) {
+        size_t r = 0;
+        for (size_t b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        reversed[i] = r;
+    }
+    // Множители этапа с полублоком h лежат подряд начиная с индекса h - 1
+    stageRe.resize(half);
+    stageIm.resize(half);
+    for (size_t h = 1; h < half; h *= 2) {
+        for (size_t j = 0; j < h; j++) {
+            double angle = -M_PI * j / h;
+            stageRe[h - 1 + j] = (float)cos(angle);
+            stageIm[h - 1 + j] = (float)sin(angle);
+        }
+    }
+    splitRe.resize(half);
+    splitIm.resize(half);
+    for (size_t k = 0; k < half; k++) {
+        double angle = -2 * M_PI * k / len;
+        splitRe[k] = (float)cos(angle);
+        splitIm[k] = (float)sin(angle);
+    }
+    re.resize(half);
+    im.resize(half);
+
+    stageFn = stageScalar;
+    isa = "scalar";
+#ifdef FFT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        stageFn = stageAvx2;
+        isa = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        stageFn = stageSse2;
+        isa = "sse2";
+    }
+#endif
+}
+
+/**
+ * Квадраты модулей спектра: |X[k]|^2 для k = 0..N/2.
+ * @param in - сигнал длины N.
+ * @param out - N/2 + 1 значений.
+ */
+void RealFft::power(const float *in, float *out) {
+    for (size_t i = 0; i < half; i++) {
+        re[reversed[i]] = in[2 * i];
+        im[reversed[i]] = in[2 * i + 1];
+    }
+    for (size_t h = 1; h < half; h *= 2) {
+        stageFn(re.data(), im.data(), stageRe.data() + h - 1, stageIm.data() + h - 1, half, h);
+    }
+    // X[k] = (Z[k] + conj(Z[M-k])) / 2 - i * W^k * (Z[k] - conj(Z[M-k])) / 2
+    out[0] = (re[0] + im[0]) * (re[0] + im[0]);
+    out[half] = (re[0] - im[0]) * (re[0] - im[0]);
+    for (size_t k = 1; k < half; k++) {
+        float zr = re[k], zi = im[k];
+        float cr = re[half - k], ci = -im[half - k];
+        float er = (zr + cr) / 2, ei = (zi + ci) / 2;
+        float dr = (zr - cr) / 2, di = (zi - ci) / 2;
+        // -i * W * d
+        float wr = splitRe[k], wi = splitIm[k];
+        float pr = wr * dr - wi * di;
+        float pi = wr * di + wi * dr;
+        float xr = er + pi;
+        float xi = ei - pr;
+        out[k] = xr * xr + xi * xi;
+    }
+}
+
+/**
+ * @return - длина сигнала.
+ */
+size_t RealFft::length() {
+    return len;
+}
+
+/**
+ * @return - название используемого набора инструкций.
+ */
+const char *RealFft::isaName() {
+    return isa;
+}
@@ -0,0 +1,57 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_FFT_H
+#define ADCCOLLECTOR_FFT_H
+#include <vector>
+#include <cstddef>
+
+/**
+ * Быстрое преобразование Фурье вещественного сигнала длины N (степень двойки).
+ * Сигнал рассматривается как комплексный длины N/2 (четные отсчеты -
+ * действительная часть, нечетные - мнимая), который преобразуется
+ * по основанию 2 с раздельными массивами действительных и мнимых частей,
+ * после чего спектр разделяется на спектр вещественного сигнала.
+ * Бабочки этапов считаются векторно (AVX2 или SSE2), вариант выбирается
+ * при создании по возможностям процессора. Память выделяется только в конструкторе.
+ */
+class RealFft {
+public:
+    explicit RealFft(size_t length);
+
+    void power(const float *in, float *out);
+    size_t length();
+    const char *isaName();
+
+private:
+    typedef void (*StageFn)(float *re, float *im, const float *wr, const float *wi, size_t n, size_t half);
+
+    size_t len;
+    size_t half;
+    std::vector<size_t> reversed;
+    std::vector<float> stageRe;
+    std::vector<float> stageIm;
+    std::vector<float> splitRe;
+    std::vector<float> splitIm;
+    std::vector<float> re;
+    std::vector<float> im;
+    StageFn stageFn;
+    const char *isa;
+};
+
+
+#endif //ADCCOLLECTOR_FFT_H
@@ -25,6 +25,21 @@ GlobalSettingsTabWidget::GlobalSettingsTabWidget(QWidget *parent) : QWidget(pare
     globalSets = Settings::instance().loadGlobalSettings();
     dataRootSelector = new DirectorySelector(tr("Data root"), globalSets.dataRoot, this);
     loggingSelector = new DirectorySelector(tr("Logging root"), globalSets.loggingRoot, this);
+    replaySelector = new DirectorySelector(tr("Replay capture file"), globalSets.replayFile, this, true);
+
+    deviceStr = new QLabel(tr("Device: "), this);
+    deviceType = new QComboBox(this);
+    deviceType->addItem(tr("LA-I24USB"));
+    deviceType->addItem(tr("Simulator"));
+    deviceType->addItem(tr("Simulator (max speed)"));
+    deviceType->addItem(tr("Replay capture"));
+    deviceType->addItem(tr("Replay capture (max speed)"));
+    if(globalSets.deviceType >= 0 && globalSets.deviceType < deviceType->count()) {
+        deviceType->setCurrentIndex(globalSets.deviceType);
+    }
+    device = new QHBoxLayout;
+    device->addWidget(deviceStr);
+    device->addWidget(deviceType);
 
     freqStr = new QLabel(tr("Frequency: "), this);
     frequencies = new QComboBox(this);
@@ -62,18 +77,159 @@ GlobalSettingsTabWidget::GlobalSettingsTabWidget(QWidget *parent) : QWidget(pare
     mean->addWidget(meanStr);
     mean->addWidget(meaningDataBuffer);
 
+    queueDepthStr = new QLabel(tr("USB transfers in flight: "), this);
+    usbQueueDepth = new QComboBox(this);
+    usbQueueDepth->addItem("2");
+    usbQueueDepth->addItem("4");
+    usbQueueDepth->addItem("8");
+    usbQueueDepth->addItem("16");
+    usbQueueDepth->addItem("32");
+    for(int i = 0; i < usbQueueDepth->count(); i++) {
+        if(usbQueueDepth->itemText(i).toInt() == globalSets.usbQueueDepth) {
+            usbQueueDepth->setCurrentIndex(i);
+            break;
+        }
+    }
+    queueDepth = new QHBoxLayout;
+    queueDepth->addWidget(queueDepthStr);
+    queueDepth->addWidget(usbQueueDepth);
+
+    transferSizeStr = new QLabel(tr("USB transfer size (bytes): "), this);
+    usbTransferSize = new QComboBox(this);
+    usbTransferSize->addItem("512");
+    usbTransferSize->addItem("1024");
+    usbTransferSize->addItem("2048");
+    usbTransferSize->addItem("4096");
+    usbTransferSize->addItem("8192");
+    for(int i = 0; i < usbTransferSize->count(); i++) {
+        if(usbTransferSize->itemText(i).toInt() == globalSets.usbTransferSize) {
+            usbTransferSize->setCurrentIndex(i);
+            break;
+        }
+    }
+    transferSize = new QHBoxLayout;
+    transferSize->addWidget(transferSizeStr);
+    transferSize->addWidget(usbTransferSize);
+
+    flushStr = new QLabel(tr("Flush data files every (seconds, 0 - every block): "), this);
+    flushInterval = new QComboBox(this);
+    flushInterval->addItem("0");
+    flushInterval->addItem("1");
+    flushInterval->addItem("5");
+    flushInterval->addItem("10");
+    flushInterval->addItem("30");
+    flushInterval->addItem("60");
+    for(int i = 0; i < flushInterval->count(); i++) {
+        if(flushInterval->itemText(i).toInt() == globalSets.flushInterval) {
+            flushInterval->setCurrentIndex(i);
+            break;
+        }
+    }
+    flush = new QHBoxLayout;
+    flush->addWidget(flushStr);
+    flush->addWidget(flushInterval);
+
+    precisionStr = new QLabel(tr("Text time precision (digits after seconds): "), this);
+    textTimePrecision = new QComboBox(this);
+    textTimePrecision->addItem("0");
+    textTimePrecision->addItem("3");
+    textTimePrecision->addItem("6");
+    for(int i = 0; i < textTimePrecision->count(); i++) {
+        if(textTimePrecision->itemText(i).toInt() == globalSets.textTimePrecision) {
+            textTimePrecision->setCurrentIndex(i);
+            break;
+        }
+    }
+    precision = new QHBoxLayout;
+    precision->addWidget(precisionStr);
+    precision->addWidget(textTimePrecision);
+
+    mseedStr = new QLabel(tr("miniSEED network, station, record length: "), this);
+    mseedNetwork = new QLineEdit(globalSets.mseedNetwork, this);
+    mseedNetwork->setMaxLength(2);
+    mseedStation = new QLineEdit(globalSets.mseedStation, this);
+    mseedStation->setMaxLength(5);
+    mseedRecordLen = new QComboBox(this);
+    mseedRecordLen->addItem("512");
+    mseedRecordLen->addItem("4096");
+    for(int i = 0; i < mseedRecordLen->count(); i++) {
+        if(mseedRecordLen->itemText(i).toInt() == globalSets.mseedRecordLen) {
+            mseedRecordLen->setCurrentIndex(i);
+            break;
+        }
+    }
+    mseed = new QHBoxLayout;
+    mseed->addWidget(mseedStr);
+    mseed->addWidget(mseedNetwork);
+    mseed->addWidget(mseedStation);
+    mseed->addWidget(mseedRecordLen);
+
+    fpsStr = new QLabel(tr("Chart frame rate limit (FPS): "), this);
+    maxFps = new QComboBox(this);
+    maxFps->addItem("10");
+    maxFps->addItem("20");
+    maxFps->addItem("30");
+    maxFps->addItem("60");
+    for(int i = 0; i < maxFps->count(); i++) {
+        if(maxFps->itemText(i).toInt() == globalSets.maxFps) {
+            maxFps->setCurrentIndex(i);
+            break;
+        }
+    }
+    fps = new QHBoxLayout;
+    fps->addWidget(fpsStr);
+    fps->addWidget(maxFps);
+
+    spectrumStr = new QLabel(tr("Spectrum window (samples): "), this);
+    spectrumLength = new QComboBox(this);
+    for(int len = 256; len <= 8192; len *= 2) {
+        spectrumLength->addItem(QString::number(len));
+        if(len == globalSets.spectrumLength) {
+            spectrumLength->setCurrentIndex(spectrumLength->count() - 1);
+        }
+    }
+    overlapStr = new QLabel(tr("Overlap (%): "), this);
+    spectrumOverlap = new QComboBox(this);
+    spectrumOverlap->addItem("0");
+    spectrumOverlap->addItem("50");
+    spectrumOverlap->addItem("75");
+    for(int i = 0; i < spectrumOverlap->count(); i++) {
+        if(spectrumOverlap->itemText(i).toInt() == globalSets.spectrumOverlap) {
+            spectrumOverlap->setCurrentIndex(i);
+            break;
+        }
+    }
+    spectrum = new QHBoxLayout;
+    spectrum->addWidget(spectrumStr);
+    spectrum->addWidget(spectrumLength);
+    spectrum->addWidget(overlapStr);
+    spectrum->addWidget(spectrumOverlap);
+
     dataInOneFileCheckBox = new QCheckBox(tr("Data in one file"), this);
     dataInOneFileCheckBox->setChecked(globalSets.dataInOneFile);
 
+    recordCapture = new QCheckBox(tr("Record raw capture"), this);
+    recordCapture->setChecked(globalSets.recordCapture);
+
     autoStart = new QCheckBox(tr("Autostart at program start"),this);
     autoStart->setChecked(globalSets.autoStart);
 
     labels = new QVBoxLayout(this);
     labels->addWidget(dataRootSelector);
     labels->addWidget(loggingSelector);
+    labels->addLayout(device);
+    labels->addWidget(replaySelector);
     labels->addLayout(freq);
     labels->addLayout(mean);
+    labels->addLayout(queueDepth);
+    labels->addLayout(transferSize);
+    labels->addLayout(flush);
+    labels->addLayout(precision);
+    labels->addLayout(mseed);
+    labels->addLayout(fps);
+    labels->addLayout(spectrum);
     labels->addWidget(dataInOneFileCheckBox);
+    labels->addWidget(recordCapture);
     labels->addWidget(autoStart);
     labels->addStretch();
 }
@@ -91,5 +247,18 @@ GlobalView GlobalSettingsTabWidget::getSets() {
     QString m = meaningDataBuffer->currentText();
     globalSets.meaningDataBuffer = m.toInt();
     globalSets.autoStart = autoStart->isChecked();
+    globalSets.usbQueueDepth = usbQueueDepth->currentText().toInt();
+    globalSets.usbTransferSize = usbTransferSize->currentText().toInt();
+    globalSets.flushInterval = flushInterval->currentText().toInt();
+    globalSets.textTimePrecision = textTimePrecision->currentText().toInt();
+    globalSets.deviceType = deviceType->currentIndex();
+    globalSets.replayFile = replaySelector->getDirectoryPath();
+    globalSets.recordCapture = recordCapture->isChecked();
+    globalSets.mseedNetwork = mseedNetwork->text();
+    globalSets.mseedStation = mseedStation->text();
+    globalSets.mseedRecordLen = mseedRecordLen->currentText().toInt();
+    globalSets.maxFps = maxFps->currentText().toInt();
+    globalSets.spectrumLength = spectrumLength->currentText().toInt();
+    globalSets.spectrumOverlap = spectrumOverlap->currentText().toInt();
     return globalSets;
 }
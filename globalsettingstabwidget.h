@@ -22,6 +22,7 @@
 #include <QBoxLayout>
 #include <QComboBox>
 #include <QCheckBox>
+#include <QLineEdit>
 #include "directoryselector.h"
 #include "settings.h"
 
@@ -38,15 +39,45 @@ public:
 private:
     DirectorySelector *dataRootSelector;
     DirectorySelector *loggingSelector;
+    DirectorySelector *replaySelector;
     QComboBox *frequencies;
     QComboBox *meaningDataBuffer;
     QCheckBox *dataInOneFileCheckBox;
     QCheckBox *autoStart;
+    QCheckBox *recordCapture;
+    QComboBox *usbQueueDepth;
+    QComboBox *usbTransferSize;
+    QComboBox *flushInterval;
+    QComboBox *textTimePrecision;
+    QComboBox *deviceType;
+    QComboBox *mseedRecordLen;
+    QComboBox *maxFps;
+    QComboBox *spectrumLength;
+    QComboBox *spectrumOverlap;
+    QLineEdit *mseedNetwork;
+    QLineEdit *mseedStation;
     QVBoxLayout *labels;
     QHBoxLayout *freq;
     QHBoxLayout *mean;
+    QHBoxLayout *queueDepth;
+    QHBoxLayout *transferSize;
+    QHBoxLayout *flush;
+    QHBoxLayout *precision;
+    QHBoxLayout *device;
+    QHBoxLayout *mseed;
+    QHBoxLayout *fps;
+    QHBoxLayout *spectrum;
     QLabel *freqStr;
     QLabel *meanStr;
+    QLabel *queueDepthStr;
+    QLabel *transferSizeStr;
+    QLabel *flushStr;
+    QLabel *precisionStr;
+    QLabel *deviceStr;
+    QLabel *mseedStr;
+    QLabel *fpsStr;
+    QLabel *spectrumStr;
+    QLabel *overlapStr;
     GlobalView globalSets;
 };
 
@@ -0,0 +1,269 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "historyloader.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "archivereader.h"
+#include "pyramid.h"
+#include "packetdecoder.h"
+
+/**
+ * Конструктор загрузки истории, запускает поток загрузки.
+ * @param root - каталог данных.
+ * @param oneFile - данные записаны в один файл, а не по часам.
+ * @param loaded - вызывается из потока загрузки после загрузки каждого участка.
+ */
+HistoryLoader::HistoryLoader(std::string root, bool oneFile, std::function<void()> loaded) {
+    dataRoot = root;
+    dataInOneFile = oneFile;
+    onLoaded = loaded;
+    loaderThread = std::thread(&HistoryLoader::loaderLoop, this);
+}
+
+/**
+ * Деструктор, дожидается загрузки текущего участка и останавливает поток.
+ */
+HistoryLoader::~HistoryLoader() {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        running = false;
+    }
+    queueCond.notify_all();
+    if (loaderThread.joinable()) {
+        loaderThread.join();
+    }
+}
+
+/**
+ * Участок истории из кэша.
+ * @param channel - номер канала.
+ * @param level - уровень истории.
+ * @param index - номер участка от начала эпохи.
+ * @param request - поставить участок в очередь загрузки, если его нет в кэше или он устарел.
+ * @return - участок (nullptr, если он еще не загружен).
+ */
+std::shared_ptr<const HistoryTile> HistoryLoader::tile(uint8_t channel, int level, int64_t index, bool request) {
+    uint64_t key = tileKey(channel, level, index);
+    std::shared_ptr<const HistoryTile> found;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        usage.splice(usage.begin(), usage, it->second.use);
+        found = it->second.tile;
+        if (found->complete || time(nullptr) - found->loadedAt < HISTORY_REFRESH_SEC) {
+            return found;
+        }
+    }
+    if (request && pending.count(key) == 0) {
+        pending.insert(key);
+        queue.push_back(key);
+        if (queue.size() > HISTORY_QUEUE_LEN) {
+            pending.erase(queue.front());
+            queue.pop_front();
+        }
+        queueCond.notify_one();
+    }
+    return found;
+}
+
+/**
+ * @param level - уровень истории.
+ * @return - длина интервала уровня (мкс).
+ */
+int64_t HistoryLoader::bucketUsec(int level) {
+    static const int64_t buckets[HISTORY_LEVELS] = HISTORY_BUCKETS_USEC;
+    return buckets[level];
+}
+
+/**
+ * @param level - уровень истории.
+ * @return - длина участка уровня (мкс).
+ */
+int64_t HistoryLoader::tileUsec(int level) {
+    return bucketUsec(level) * HISTORY_TILE_LEN;
+}
+
+/**
+ * Выбор уровня для отображения: самый грубый уровень, интервал которого
+ * не длиннее столбца пикселей.
+ * @param usecPerColumn - длительность столбца пикселей (мкс).
+ * @return - уровень истории.
+ */
+int HistoryLoader::levelFor(double usecPerColumn) {
+    int level = 0;
+    while (level + 1 < HISTORY_LEVELS && bucketUsec(level + 1) <= usecPerColumn) {
+        level++;
+    }
+    return level;
+}
+
+/**
+ * Цикл потока загрузки: берет последний запрос, загружает участок
+ * и кладет его в кэш.
+ */
+void HistoryLoader::loaderLoop() {
+    std::unique_lock<std::mutex> lock(cacheMutex);
+    while (true) {
+        queueCond.wait(lock, [this] { return !running || !queue.empty(); });
+        if (!running) {
+            return;
+        }
+        uint64_t key = queue.back();
+        queue.pop_back();
+        lock.unlock();
+        std::shared_ptr<HistoryTile> t = load(key >> 56, (key >> 48) & 0xff, key & 0xffffffffffffull);
+        lock.lock();
+        pending.erase(key);
+        store(key, t);
+        lock.unlock();
+        if (onLoaded) {
+            onLoaded();
+        }
+        lock.lock();
+    }
+}
+
+/**
+ * Загрузка участка из архива.
+ * @param channel - номер канала.
+ * @param level - уровень истории.
+ * @param index - номер участка от начала эпохи.
+ * @return - участок.
+ */
+std::shared_ptr<HistoryTile> HistoryLoader::load(uint8_t channel, int level, int64_t index) {
+    std::shared_ptr<HistoryTile> t = std::make_shared<HistoryTile>();
+    t->channel = channel;
+    t->level = level;
+    t->index = index;
+    t->mins.assign(HISTORY_TILE_LEN, std::numeric_limits<float>::quiet_NaN());
+    t->maxs.assign(HISTORY_TILE_LEN, std::numeric_limits<float>::quiet_NaN());
+    t->loadedAt = time(nullptr);
+    // Участок, который еще может пополниться, будет перечитан
+    t->complete = (index + 1) * tileUsec(level) / 1000000 + HISTORY_REFRESH_SEC < t->loadedAt;
+    if (level < HISTORY_RAW_LEVELS) {
+        loadRaw(t.get());
+    } else {
+        loadPyramid(t.get());
+    }
+    return t;
+}
+
+/**
+ * Заполнение участка из файлов пирамиды часов, которые он перекрывает.
+ * @param t - участок.
+ */
+void HistoryLoader::loadPyramid(HistoryTile *t) {
+    static const uint32_t bucketSec[PYRAMID_LEVELS] = PYRAMID_BUCKETS_SEC;
+    int level = t->level - HISTORY_RAW_LEVELS;
+    int64_t bucket = bucketUsec(t->level);
+    int64_t start = t->index * tileUsec(t->level);
+    int64_t end = start + tileUsec(t->level);
+    PyramidReader reader;
+    std::vector<PyramidBucket> buckets;
+    for (time_t hour = start / 1000000 - start / 1000000 % 3600; (int64_t)hour * 1000000 < end; hour += 3600) {
+        int64_t hourUsec = (int64_t)hour * 1000000;
+        int64_t from = std::max(start, hourUsec);
+        int64_t to = std::min(end, hourUsec + (int64_t)3600 * 1000000);
+        size_t first = (from - hourUsec) / bucket;
+        size_t count = (to - from) / bucket;
+        if (reader.open(pyramidPath(dataRoot, hour, t->channel)) != SUCCESS ||
+            reader.header().bucketSec[level] != bucketSec[level] ||
+            reader.read(level, first, count, &buckets) != SUCCESS) {
+            continue;
+        }
+        double scale = reader.header().scale;
+        size_t pos = (from - start) / bucket;
+        for (size_t i = 0; i < buckets.size(); i++) {
+            if (buckets[i].count > 0) {
+                t->mins[pos + i] = (float)(buckets[i].min * scale);
+                t->maxs[pos + i] = (float)(buckets[i].max * scale);
+            }
+        }
+    }
+}
+
+/**
+ * Заполнение участка минимумами и максимумами отсчетов двоичных файлов.
+ * @param t - участок.
+ */
+void HistoryLoader::loadRaw(HistoryTile *t) {
+    int64_t bucket = bucketUsec(t->level);
+    int64_t start = t->index * tileUsec(t->level);
+    int64_t end = start + tileUsec(t->level);
+    ChannelArchive archive(dataRoot, t->channel, dataInOneFile, 0);
+    SampleSpan span;
+    if (archive.seek(start, end) != SUCCESS) {
+        return;
+    }
+    while (archive.next(&span) == SUCCESS) {
+        // Блок может начинаться до начала участка
+        size_t i = 0;
+        if (span.startUsec < start) {
+            i = (size_t)std::ceil((start - span.startUsec) / span.stepUsec);
+        }
+        for (; i < span.len; i++) {
+            int64_t usec = span.startUsec + (int64_t)(i * span.stepUsec);
+            if (usec >= end) {
+                break;
+            }
+            if (span.data[i] == NO_SAMPLE) {
+                continue;
+            }
+            size_t b = (usec - start) / bucket;
+            float value = (float)(span.data[i] * VOLTS_SCALE);
+            if (std::isnan(t->mins[b])) {
+                t->mins[b] = t->maxs[b] = value;
+            } else {
+                t->mins[b] = std::min(t->mins[b], value);
+                t->maxs[b] = std::max(t->maxs[b], value);
+            }
+        }
+    }
+}
+
+/**
+ * Запись участка в кэш с вытеснением давно не использованных участков.
+ * Вызывается под cacheMutex.
+ * @param key - ключ участка.
+ * @param t - участок.
+ */
+void HistoryLoader::store(uint64_t key, std::shared_ptr<const HistoryTile> t) {
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        it->second.tile = t;
+        usage.splice(usage.begin(), usage, it->second.use);
+        return;
+    }
+    usage.push_front(key);
+    cache[key] = Entry {t, usage.begin()};
+    while (cache.size() > HISTORY_CACHE_TILES) {
+        cache.erase(usage.back());
+        usage.pop_back();
+    }
+}
+
+/**
+ * @param channel - номер канала.
+ * @param level - уровень истории.
+ * @param index - номер участка от начала эпохи.
+ * @return - ключ участка в кэше.
+ */
+uint64_t HistoryLoader::tileKey(uint8_t channel, int level, int64_t index) {
+    return ((uint64_t)channel << 56) | ((uint64_t)level << 48) | ((uint64_t)index & 0xffffffffffffull);
+}
@@ -0,0 +1,113 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_HISTORYLOADER_H
+#define ADCCOLLECTOR_HISTORYLOADER_H
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include "adcdefs.h"
+
+// Buckets in one history tile
+#define HISTORY_TILE_LEN 256
+// Tiles kept in the cache
+#define HISTORY_CACHE_TILES 512
+// Pending tile requests (older ones are dropped)
+#define HISTORY_QUEUE_LEN 64
+// Number of history levels, the first ones are built from raw samples
+#define HISTORY_LEVELS 6
+#define HISTORY_RAW_LEVELS 2
+// Bucket length of each level (usec), the rest match PYRAMID_BUCKETS_SEC
+#define HISTORY_BUCKETS_USEC {10000, 100000, 1000000, 10000000, 60000000, 600000000}
+// Tiles that may still get data are reloaded after this time (sec)
+#define HISTORY_REFRESH_SEC 10
+
+/**
+ * Участок истории канала: минимумы и максимумы HISTORY_TILE_LEN интервалов
+ * одного уровня. Интервал без данных имеет значения NaN.
+ */
+struct HistoryTile {
+    uint8_t channel;
+    int level;
+    int64_t index;
+    std::vector<float> mins;
+    std::vector<float> maxs;
+    bool complete;
+    time_t loadedAt;
+};
+
+/**
+ * Фоновая загрузка истории каналов из архива. Грубые уровни читаются
+ * из файлов пирамиды, мелкие строятся по отсчетам двоичных файлов.
+ * Загруженные участки хранятся в кэше с вытеснением давно не использованных.
+ * Запросы обрабатываются от последнего к первому, поэтому при прокрутке
+ * в первую очередь загружается то, что видно сейчас.
+ */
+class HistoryLoader {
+public:
+    HistoryLoader(std::string root, bool oneFile, std::function<void()> loaded);
+    ~HistoryLoader();
+
+    std::shared_ptr<const HistoryTile> tile(uint8_t channel, int level, int64_t index, bool request);
+
+    static int64_t bucketUsec(int level);
+    static int64_t tileUsec(int level);
+    static int levelFor(double usecPerColumn);
+
+private:
+    /**
+     * Участок в кэше и его место в порядке использования.
+     */
+    struct Entry {
+        std::shared_ptr<const HistoryTile> tile;
+        std::list<uint64_t>::iterator use;
+    };
+
+    std::string dataRoot;
+    bool dataInOneFile;
+    std::function<void()> onLoaded;
+
+    std::thread loaderThread;
+    std::mutex cacheMutex;
+    std::condition_variable queueCond;
+    bool running = true;
+    std::deque<uint64_t> queue;
+    std::unordered_set<uint64_t> pending;
+    std::unordered_map<uint64_t, Entry> cache;
+    std::list<uint64_t> usage;
+
+    void loaderLoop();
+    std::shared_ptr<HistoryTile> load(uint8_t channel, int level, int64_t index);
+    void loadPyramid(HistoryTile *t);
+    void loadRaw(HistoryTile *t);
+    void store(uint64_t key, std::shared_ptr<const HistoryTile> t);
+
+    static uint64_t tileKey(uint8_t channel, int level, int64_t index);
+};
+
+
+#endif //ADCCOLLECTOR_HISTORYLOADER_H
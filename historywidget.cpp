@@ -0,0 +1,387 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "historywidget.h"
+#include <QDateTime>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <sys/time.h>
+
+// Shortest time span that can be shown (usec)
+#define HISTORY_MIN_SPAN 1000000LL
+// Height of the time axis (pixels)
+#define HISTORY_AXIS_HEIGHT 20
+
+/**
+ * Конструктор окна истории. Показывает последние сутки канала.
+ * @param channel - номер канала.
+ * @param parent - указатель на родительский виджет.
+ */
+HistoryWidget::HistoryWidget(int channel, QWidget *parent) : QWidget(parent, Qt::Window) {
+    chan = channel;
+    ChannelView channelView = Settings::instance().loadChannelSettings(channel);
+    GlobalView globalView = Settings::instance().loadGlobalSettings();
+    name = channelView.name;
+    colorOfGraph = channelView.colorOfGraph;
+    colorOfGrid = channelView.colorOfGrid;
+    colorOfText = channelView.colorOfText;
+    // Поток загрузки только планирует перерисовку в потоке окна
+    loader = std::make_unique<HistoryLoader>(globalView.dataRoot.toStdString(), globalView.dataInOneFile, [this] {
+        QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+    });
+
+    this->setAttribute(Qt::WA_DeleteOnClose);
+    this->setWindowTitle(tr("History") + " - " + name);
+    this->setFocusPolicy(Qt::StrongFocus);
+    this->setAutoFillBackground(true);
+    QPalette palette;
+    palette.setColor(QPalette::Background, Qt::black);
+    this->setPalette(palette);
+
+    // Участки, которые еще пополняются, перечитываются при перерисовке
+    refreshTimer = new QTimer(this);
+    connect(refreshTimer, &QTimer::timeout, this, QOverload<>::of(&QWidget::update));
+    refreshTimer->start(HISTORY_REFRESH_SEC * 1000);
+
+    showLast(HISTORY_INITIAL_SPAN);
+}
+
+/**
+ * Деструктор окна истории. Поток загрузки останавливается до разрушения окна,
+ * которому он отправляет запросы перерисовки.
+ */
+HistoryWidget::~HistoryWidget() {
+    loader.reset();
+}
+
+/**
+ * Показывает интервал, заканчивающийся текущим временем.
+ * @param span - длина интервала (мкс).
+ */
+void HistoryWidget::showLast(int64_t span) {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    int64_t now = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    setView(now - span, now);
+}
+
+/**
+ * Устанавливает показываемый интервал, ограничивая его длину.
+ * @param from - начало интервала (мкс).
+ * @param to - конец интервала (мкс).
+ */
+void HistoryWidget::setView(int64_t from, int64_t to) {
+    int64_t span = qBound((int64_t)HISTORY_MIN_SPAN, to - from, (int64_t)HISTORY_MAX_SPAN);
+    int64_t middle = from / 2 + to / 2;
+    viewFrom = qMax((int64_t)0, middle - span / 2);
+    viewTo = viewFrom + span;
+    this->update();
+}
+
+/**
+ * Изменяет масштаб так, что время под столбцом x остается на месте.
+ * @param factor - во сколько раз меняется длина интервала.
+ * @param x - столбец пикселей.
+ */
+void HistoryWidget::zoom(double factor, int x) {
+    double usecPerColumn = (double)(viewTo - viewFrom) / qMax(1, this->width());
+    int64_t anchor = viewFrom + (int64_t)(x * usecPerColumn);
+    int64_t span = qBound((int64_t)HISTORY_MIN_SPAN, (int64_t)((viewTo - viewFrom) * factor),
+                          (int64_t)HISTORY_MAX_SPAN);
+    int64_t from = anchor - (int64_t)((double)(anchor - viewFrom) / (viewTo - viewFrom) * span);
+    setView(from, from + span);
+}
+
+/**
+ * Собирает минимумы и максимумы столбцов пикселей из участков уровня,
+ * интервал которого не длиннее столбца. Недостающие участки запрашиваются,
+ * а вместо них берутся участки более грубых уровней из кэша.
+ * @param columns - число столбцов.
+ */
+void HistoryWidget::collectColumns(int columns) {
+    double usecPerColumn = (double)(viewTo - viewFrom) / columns;
+    int level = HistoryLoader::levelFor(usecPerColumn);
+    int64_t bucket = HistoryLoader::bucketUsec(level);
+    columnMins.assign(columns, std::numeric_limits<float>::quiet_NaN());
+    columnMaxs.assign(columns, std::numeric_limits<float>::quiet_NaN());
+    loading = false;
+
+    // Последний использованный участок каждого уровня
+    std::shared_ptr<const HistoryTile> tiles[HISTORY_LEVELS];
+    int64_t tileIndex[HISTORY_LEVELS];
+    std::fill(tileIndex, tileIndex + HISTORY_LEVELS, -1);
+    auto lookup = [&](int l, int64_t usec, bool request, float *mn, float *mx) {
+        int64_t index = usec / HistoryLoader::tileUsec(l);
+        if(index != tileIndex[l]) {
+            tileIndex[l] = index;
+            tiles[l] = loader->tile(chan, l, index, request);
+        }
+        if(!tiles[l]) {
+            return false;
+        }
+        size_t pos = (usec - index * HistoryLoader::tileUsec(l)) / HistoryLoader::bucketUsec(l);
+        *mn = tiles[l]->mins[pos];
+        *mx = tiles[l]->maxs[pos];
+        return true;
+    };
+
+    for(int64_t b = viewFrom / bucket; b * bucket < viewTo; b++) {
+        int64_t usec = b * bucket;
+        float mn, mx;
+        if(!lookup(level, usec, true, &mn, &mx)) {
+            loading = true;
+            bool found = false;
+            for(int l = level + 1; l < HISTORY_LEVELS && !found; l++) {
+                found = lookup(l, usec, false, &mn, &mx);
+            }
+            if(!found) {
+                continue;
+            }
+        }
+        if(std::isnan(mn)) {
+            continue;
+        }
+        int first = qMax(0, (int)((usec - viewFrom) / usecPerColumn));
+        int last = qMin(columns - 1, (int)((usec + bucket - 1 - viewFrom) / usecPerColumn));
+        for(int c = first; c <= last; c++) {
+            if(std::isnan(columnMins[c])) {
+                columnMins[c] = mn;
+                columnMaxs[c] = mx;
+            } else {
+                columnMins[c] = qMin(columnMins[c], mn);
+                columnMaxs[c] = qMax(columnMaxs[c], mx);
+            }
+        }
+    }
+}
+
+/**
+ * Рисует горизонтальные линии сетки со значениями.
+ * @param painter - рисовальщик окна.
+ * @param min - значение нижнего края графика.
+ * @param max - значение верхнего края графика.
+ */
+void HistoryWidget::drawGrid(QPainter *painter, double min, double max) {
+    int height = this->height() - HISTORY_AXIS_HEIGHT;
+    QFont font = painter->font();
+    font.setPixelSize(12);
+    painter->setFont(font);
+    for(int y = height; y > 0; y -= Y_STEP_IN_PIXELS) {
+        painter->setPen(colorOfGrid);
+        painter->drawLine(0, y, this->width(), y);
+        painter->setPen(colorOfText);
+        double value = min + (max - min) * (height - y) / height;
+        painter->drawText(2, y - 3, QString("%1").arg(value, 0, 'f', 4));
+    }
+}
+
+/**
+ * Рисует вертикальные линии сетки и подписи времени (UTC). Шаг выбирается
+ * из ряда круглых значений так, чтобы подписи не налезали друг на друга.
+ * @param painter - рисовальщик окна.
+ */
+void HistoryWidget::drawTimeAxis(QPainter *painter) {
+    static const int64_t steps[] = {10000, 50000, 100000, 500000, 1000000, 5000000, 10000000, 30000000,
+                                    60000000, 300000000, 600000000, 1800000000, 3600000000LL, 10800000000LL,
+                                    21600000000LL, 43200000000LL, 86400000000LL, 172800000000LL,
+                                    604800000000LL};
+    double usecPerColumn = (double)(viewTo - viewFrom) / this->width();
+    int64_t step = steps[0];
+    for(int64_t s : steps) {
+        step = s;
+        if(s / usecPerColumn >= X_MIN_STEP_IN_PIXELS) {
+            break;
+        }
+    }
+    QString format;
+    if(step < 1000000) {
+        format = "hh:mm:ss.zzz";
+    } else if(step < 60000000) {
+        format = "hh:mm:ss";
+    } else if(step < 86400000000LL) {
+        format = "dd.MM hh:mm";
+    } else {
+        format = "dd.MM.yyyy";
+    }
+
+    int height = this->height() - HISTORY_AXIS_HEIGHT;
+    for(int64_t t = (viewFrom + step - 1) / step * step; t < viewTo; t += step) {
+        int x = (int)((t - viewFrom) / usecPerColumn);
+        painter->setPen(colorOfGrid);
+        painter->drawLine(x, 0, x, height);
+        painter->setPen(colorOfText);
+        QString label = QDateTime::fromMSecsSinceEpoch(t / 1000, Qt::UTC).toString(format);
+        painter->drawText(x + 2, this->height() - 5, label);
+    }
+}
+
+/**
+ * Рисует график ломаными: в каждом столбце от максимума до минимума
+ * (в соседних столбцах - в обратном порядке). Столбцы без данных
+ * разрывают график.
+ * @param painter - рисовальщик окна.
+ * @param min - значение нижнего края графика.
+ * @param max - значение верхнего края графика.
+ */
+void HistoryWidget::drawGraph(QPainter *painter, double min, double max) {
+    int height = this->height() - HISTORY_AXIS_HEIGHT;
+    double pixelsPerVolt = height / (max - min);
+    painter->setPen(QPen(colorOfGraph, 1));
+    int columns = (int)columnMins.size();
+    int c = 0;
+    while(c < columns) {
+        if(std::isnan(columnMins[c])) {
+            c++;
+            continue;
+        }
+        trace.clear();
+        for(; c < columns && !std::isnan(columnMins[c]); c++) {
+            double yHi = height - (columnMaxs[c] - min) * pixelsPerVolt;
+            double yLo = height - (columnMins[c] - min) * pixelsPerVolt + 1;
+            if((c & 1) == 0) {
+                trace << QPointF(c + 0.5, yHi) << QPointF(c + 0.5, yLo);
+            } else {
+                trace << QPointF(c + 0.5, yLo) << QPointF(c + 0.5, yHi);
+            }
+        }
+        painter->drawPolyline(trace);
+    }
+}
+
+/**
+ * Отрисовывает окно: сетку, график видимого интервала и подписи.
+ */
+void HistoryWidget::paintEvent(QPaintEvent *) {
+    int columns = qMax(1, this->width());
+    collectColumns(columns);
+
+    double min = std::numeric_limits<double>::max();
+    double max = -std::numeric_limits<double>::max();
+    for(int c = 0; c < columns; c++) {
+        if(!std::isnan(columnMins[c])) {
+            min = qMin(min, (double)columnMins[c]);
+            max = qMax(max, (double)columnMaxs[c]);
+        }
+    }
+    if(min > max) {
+        min = -1;
+        max = 1;
+    } else if(max - min < 1e-6) {
+        min -= 1e-3;
+        max += 1e-3;
+    } else {
+        double quantum = pow(10, floor(log10(max - min)) - 1);
+        min = floor(min / quantum) * quantum;
+        max = ceil(max / quantum) * quantum;
+    }
+
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing, false);
+    drawGrid(&painter, min, max);
+    drawTimeAxis(&painter);
+    drawGraph(&painter, min, max);
+
+    QFont nameFont(painter.font());
+    nameFont.setPixelSize(18);
+    painter.setFont(nameFont);
+    painter.setPen(colorOfText);
+    QString title = name + " (UTC)";
+    if(loading) {
+        title += " - " + tr("Loading...");
+    }
+    painter.drawText(this->width() / 2 - QFontMetrics(nameFont).width(title) / 2, 20, title);
+}
+
+/**
+ * Устанавливает изначальные размеры окна.
+ * @return - размер окна.
+ */
+QSize HistoryWidget::sizeHint() const {
+    return QSize(1000, 500);
+}
+
+/**
+ * Колесо мыши меняет масштаб вокруг указателя.
+ * @param ev - событие колеса.
+ */
+void HistoryWidget::wheelEvent(QWheelEvent *ev) {
+    double steps = ev->angleDelta().y() / 120.0;
+    zoom(pow(HISTORY_ZOOM_STEP, -steps), (int)ev->position().x());
+}
+
+/**
+ * Начало прокрутки перетаскиванием.
+ * @param ev - событие мыши.
+ */
+void HistoryWidget::mousePressEvent(QMouseEvent *ev) {
+    if(ev->button() == Qt::LeftButton) {
+        dragging = true;
+        dragX = ev->x();
+        dragFrom = viewFrom;
+    }
+}
+
+/**
+ * Прокрутка перетаскиванием.
+ * @param ev - событие мыши.
+ */
+void HistoryWidget::mouseMoveEvent(QMouseEvent *ev) {
+    if(dragging) {
+        int64_t span = viewTo - viewFrom;
+        int64_t from = dragFrom - (int64_t)((double)(ev->x() - dragX) * span / qMax(1, this->width()));
+        setView(from, from + span);
+    }
+}
+
+/**
+ * Конец прокрутки перетаскиванием.
+ * @param ev - событие мыши.
+ */
+void HistoryWidget::mouseReleaseEvent(QMouseEvent *ev) {
+    if(ev->button() == Qt::LeftButton) {
+        dragging = false;
+    }
+}
+
+/**
+ * Клавиши: Home - к текущему времени, +/- - масштаб, стрелки - прокрутка.
+ * @param ev - событие клавиатуры.
+ */
+void HistoryWidget::keyPressEvent(QKeyEvent *ev) {
+    int64_t span = viewTo - viewFrom;
+    switch(ev->key()) {
+        case Qt::Key_Home:
+            showLast(span);
+            break;
+        case Qt::Key_Plus:
+        case Qt::Key_Equal:
+            zoom(1 / HISTORY_ZOOM_STEP, this->width() / 2);
+            break;
+        case Qt::Key_Minus:
+            zoom(HISTORY_ZOOM_STEP, this->width() / 2);
+            break;
+        case Qt::Key_Left:
+            setView(viewFrom - span / 4, viewTo - span / 4);
+            break;
+        case Qt::Key_Right:
+            setView(viewFrom + span / 4, viewTo + span / 4);
+            break;
+        default:
+            QWidget::keyPressEvent(ev);
+    }
+}
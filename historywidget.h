@@ -0,0 +1,94 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_HISTORYWIDGET_H
+#define ADCCOLLECTOR_HISTORYWIDGET_H
+#include <QWidget>
+#include <QPainter>
+#include <QPolygonF>
+#include <QTimer>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QKeyEvent>
+#include <memory>
+#include <vector>
+#include "settings.h"
+#include "historyloader.h"
+
+// Time span shown when the window opens (usec)
+#define HISTORY_INITIAL_SPAN (24LL * 3600 * 1000000)
+// Longest time span that can be shown (usec)
+#define HISTORY_MAX_SPAN (31LL * 24 * 3600 * 1000000)
+// Span change per wheel step
+#define HISTORY_ZOOM_STEP 1.25
+
+/**
+ * Окно истории канала: график по данным архива с прокруткой и масштабированием
+ * по времени. Минимумы и максимумы столбцов берутся из участков HistoryLoader;
+ * пока нужный участок загружается, рисуется более грубый уровень из кэша.
+ */
+class HistoryWidget : public QWidget {
+Q_OBJECT
+
+public:
+    explicit HistoryWidget(int channel, QWidget *parent = nullptr);
+    ~HistoryWidget() override;
+
+private:
+    const int Y_STEP_IN_PIXELS = 30;
+    const int X_MIN_STEP_IN_PIXELS = 100;
+
+    uint8_t chan;
+    QString name;
+    QColor colorOfGraph;
+    QColor colorOfText;
+    QColor colorOfGrid;
+    std::unique_ptr<HistoryLoader> loader;
+    QTimer *refreshTimer;
+
+    // Показываемый интервал времени (мкс от начала эпохи)
+    int64_t viewFrom;
+    int64_t viewTo;
+    bool dragging = false;
+    int dragX = 0;
+    int64_t dragFrom = 0;
+
+    std::vector<float> columnMins;
+    std::vector<float> columnMaxs;
+    bool loading = false;
+    QPolygonF trace;
+
+    void showLast(int64_t span);
+    void setView(int64_t from, int64_t to);
+    void zoom(double factor, int x);
+    void collectColumns(int columns);
+    void drawGrid(QPainter *painter, double min, double max);
+    void drawTimeAxis(QPainter *painter);
+    void drawGraph(QPainter *painter, double min, double max);
+
+protected:
+    void paintEvent(QPaintEvent *) override;
+    QSize sizeHint() const override;
+    void wheelEvent(QWheelEvent *ev) override;
+    void mousePressEvent(QMouseEvent *ev) override;
+    void mouseMoveEvent(QMouseEvent *ev) override;
+    void mouseReleaseEvent(QMouseEvent *ev) override;
+    void keyPressEvent(QKeyEvent *ev) override;
+};
+
+
+#endif //ADCCOLLECTOR_HISTORYWIDGET_H
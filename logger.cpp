@@ -0,0 +1,96 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "logger.h"
+#include <cstdio>
+#include <ctime>
+
+/**
+ * Конструктор журнала.
+ * @param loggingRoot - каталог для файла журнала.
+ */
+Logger::Logger(std::string loggingRoot) {
+    root = loggingRoot;
+}
+
+/**
+ * Логирование сообщений.
+ * @param level - уровень сообщения.
+ * @param message - сообщение.
+ * @return - false, если файл журнала не удалось открыть.
+ */
+bool Logger::logging(logLevel level, const char *message) {
+    const char *lvl;
+    switch(level) {
+        case DEBUG:
+            lvl = "DEBUG";
+            break;
+        case INFO:
+            lvl = "INFO";
+            break;
+        case WARN:
+            lvl = "WARNING";
+            break;
+        case ERROR:
+            lvl = "ERROR";
+            break;
+        case FATAL:
+            lvl = "FATAL";
+            break;
+        default:
+            lvl = "INFO";
+    }
+    if(loggingError) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(logMutex);
+    time_t now = time(NULL);
+    struct tm t;
+    gmtime_r(&now, &t);
+    char msgbuf[1024];
+    snprintf(msgbuf, 1024, "%04d-%02d-%02d %02d:%02d:%02d %s: %s",
+             t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, lvl, message);
+
+    char log_filename[1024];
+    snprintf(log_filename, 1024, "%s/datacollect.log", root.c_str());
+    FILE *lf = fopen(log_filename, "a");
+    if (lf == NULL) {
+        loggingError = true;
+        return false;
+    }
+    fprintf(lf, "%s\n", msgbuf);
+    fflush(lf);
+    fclose(lf);
+    return true;
+}
+
+/**
+ * Установка каталога для файла журнала.
+ * @param loggingRoot - каталог для файла журнала.
+ */
+void Logger::setRoot(std::string loggingRoot) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    root = loggingRoot;
+    loggingError = false;
+}
+
+/**
+ * @return - произошла ли ошибка открытия файла журнала.
+ */
+bool Logger::failed() {
+    return loggingError;
+}
@@ -0,0 +1,52 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_LOGGER_H
+#define ADCCOLLECTOR_LOGGER_H
+#include <string>
+#include <mutex>
+#include <atomic>
+
+// Logging levels
+enum logLevel {
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+    FATAL
+};
+
+/**
+ * Журнал работы сбора данных (datacollect.log).
+ * Может использоваться одновременно из нескольких потоков.
+ */
+class Logger {
+public:
+    explicit Logger(std::string loggingRoot);
+
+    bool logging(logLevel level, const char *message);
+    void setRoot(std::string loggingRoot);
+    bool failed();
+
+private:
+    std::string root;
+    std::mutex logMutex;
+    std::atomic<bool> loggingError {false};
+};
+
+
+#endif //ADCCOLLECTOR_LOGGER_H
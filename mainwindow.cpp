@@ -105,6 +105,8 @@ void MainWindow::initToolBar() {
     infoWidget = new InfoWidget(this);
 
     connect(chartUpdateSpeed, &QComboBox::currentTextChanged, this, &MainWindow::slotUpdateTimerSpeed);
+    chartUpdateSpeed->addItem("0.05");
+    chartUpdateSpeed->addItem("0.1");
     chartUpdateSpeed->addItem("0.2");
     chartUpdateSpeed->addItem("0.5");
     chartUpdateSpeed->addItem("1");
@@ -112,8 +114,9 @@ void MainWindow::initToolBar() {
     chartUpdateSpeed->addItem("5");
     chartUpdateSpeed->addItem("10");
     chartUpdateSpeed->addItem("30");
+    // Не больше SPECTRUM_MAX_INTERVAL
     chartUpdateSpeed->addItem("60");
-    chartUpdateSpeed->setCurrentIndex(2);
+    chartUpdateSpeed->setCurrentIndex(4);
     slotUpdateTimerSpeed(chartUpdateSpeed->currentText());
 
     toolBar->setIconSize(QSize(40, 40));
@@ -166,6 +169,8 @@ void MainWindow::slotStart() {
     timer->start(chartUpdateSpeed->currentText().toDouble() * 1000);
     preferencesAction->setEnabled(false);
     stopAction->setEnabled(true);
+    // Отсчеты прошлого запуска не показываются
+    adcCollector->takeDisplayBlocks(&displayBlocks);
     adcCollector->start();
 }
 
@@ -266,9 +271,10 @@ void MainWindow::slotUpdateTimerSpeed(const QString &s) {
 
 /**
  * Слот, связанный с таймером.
- * Подгружает данные для каналов с каждым тиком таймера.
+ * Передает каналам все отсчеты, полученные с прошлого тика таймера.
  */
 void MainWindow::slotUpdateTimer() {
-    std::vector<double> chansData = adcCollector->getChannelData();
-    centralWidget->setDataForChannels(chansData);
+    if (adcCollector->takeDisplayBlocks(&displayBlocks) > 0) {
+        centralWidget->setDataForChannels(displayBlocks);
+    }
 }
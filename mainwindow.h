@@ -71,6 +71,7 @@ private:
     QComboBox *chartUpdateSpeed;
     QLabel *chartUpdateSpeedStr;
     QTimer *timer;
+    std::vector<DisplayBlock> displayBlocks;
     bool errMsgExist;
 
     void initActions();
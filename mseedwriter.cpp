@@ -0,0 +1,353 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mseedwriter.h"
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+/**
+ * Запись 16-битного числа в порядке big-endian.
+ * @param p - выходной буфер.
+ * @param v - число.
+ */
+static void putBE16(uint8_t *p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v & 0xff;
+}
+
+/**
+ * Запись 32-битного числа в порядке big-endian.
+ * @param p - выходной буфер.
+ * @param v - число.
+ */
+static void putBE32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+/**
+ * Способы упаковки разностей в слово Steim2, от самого плотного.
+ */
+struct SteimPack {
+    int count;
+    int bits;
+    uint32_t nibble;
+    int dnib;
+};
+
+static const SteimPack STEIM2_PACKS[] = {
+    {7, 4, 3, 2},
+    {6, 5, 3, 1},
+    {5, 6, 3, 0},
+    {4, 8, 1, -1},
+    {3, 10, 2, 3},
+    {2, 15, 2, 2},
+    {1, 30, 2, 1}
+};
+
+/**
+ * Конструктор записи miniSEED.
+ * @param root - корневой каталог данных.
+ * @param channel - номер канала.
+ * @param oneFile - писать все данные в один файл.
+ * @param flushInterval - интервал сброса буферов на диск (сек).
+ * @param frequency - частота дискретизации АЦП (Гц).
+ * @param averaging - коэффициент усреднения (0 - нет).
+ * @param recordLen - длина записи (512 или 4096 байт).
+ * @param network - код сети (до 2 символов).
+ * @param station - код станции (до 5 символов).
+ * @param log - журнал.
+ * @param tag - добавка к имени файлов (для дополнительных выводов канала).
+ */
+MseedWriter::MseedWriter(std::string root, uint8_t channel, bool oneFile, uint32_t flushInterval, int frequency,
+                         uint16_t averaging, int recordLen, std::string network, std::string station, Logger *log,
+                         std::string tag) {
+    dataInOneFile = oneFile;
+    freq = frequency;
+    aver = averaging;
+    rate = aver > 0 ? (double)freq / aver : freq;
+    recLen = recordLen == 4096 ? 4096 : 512;
+    logger = log;
+
+    // Код канала: диапазон по частоте, H - сейсмометр, номер канала
+    char band = rate >= 250 ? 'D' : rate >= 80 ? 'E' : rate >= 10 ? 'S' : rate >= 1 ? 'M' : 'L';
+    snprintf(code, sizeof(code), "%-5.5s%-2.2s%c%c%c%-2.2s", station.c_str(), "00", band, 'H', '1' + channel,
+             network.c_str());
+
+    char suffix[FILE_LEN], name[FILE_LEN];
+    snprintf(suffix, FILE_LEN, "_%02d%s.mseed", channel, tag.c_str());
+    snprintf(name, FILE_LEN, "data_ch%d%s.mseed", channel, tag.c_str());
+    file.reset(new RotatingFile(root, suffix, name, oneFile, flushInterval, log));
+    nframes = (recLen - MSEED_HEADER_LEN) / STEIM_FRAME_LEN;
+    record.resize(recLen);
+}
+
+/**
+ * Деструктор. Дописывает незаполненную запись.
+ */
+MseedWriter::~MseedWriter() {
+    close();
+}
+
+/**
+ * Добавление отсчетов и запись заполненных записей.
+ * @param data - отсчеты (24-битные значения, сдвинутые на 8 бит влево).
+ * @param len - число отсчетов.
+ * @param tv - время первого отсчета.
+ * @return - код ошибки.
+ */
+int8_t MseedWriter::write(const int32_t *data, size_t len, const struct timeval *tv) {
+    int64_t usec = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    double period = 1000000.0 / rate;
+    time_t hour = dataInOneFile ? 0 : tv->tv_sec / 3600;
+    size_t count = packed + pending.size();
+    if (count > 0) {
+        int64_t expected = recordStart + llround(count * period);
+        // Допустимое расхождение - длительность одного пакета АЦП
+        int64_t tolerance = llround(period * CHANBUF_LEN / (aver > 0 ? aver : 1));
+        bool gap = llabs(usec - expected) > tolerance;
+        if (gap || hour != recordHour || usec - recordStart >= (int64_t)MSEED_MAX_RECORD_SPAN * 1000000) {
+            if (finish() != SUCCESS) {
+                return IO_FAILURE;
+            }
+            continuous = !gap;
+        }
+    }
+    if (packed + pending.size() == 0) {
+        recordStart = usec;
+        recordHour = hour;
+    }
+    for (size_t i = 0; i < len; i++) {
+        pending.push_back(data[i] >> 8);
+    }
+    return pack(false);
+}
+
+/**
+ * Запись всех накопленных отсчетов, последняя запись может быть заполнена не полностью.
+ * @return - код ошибки.
+ */
+int8_t MseedWriter::finish() {
+    return pack(true);
+}
+
+/**
+ * Запись накопленных отсчетов и закрытие файла.
+ * @return - код ошибки.
+ */
+int8_t MseedWriter::close() {
+    int8_t res = finish();
+    if (file->close() != SUCCESS) {
+        res = IO_FAILURE;
+    }
+    return res;
+}
+
+/**
+ * Упаковка ожидающих отсчетов в кадры записи; заполненные записи пишутся в файл.
+ * @param final - упаковать все отсчеты и записать запись, даже если она заполнена не полностью.
+ * @return - код ошибки.
+ */
+int8_t MseedWriter::pack(bool final) {
+    int8_t res = SUCCESS;
+    size_t next = 0;
+    // Без final слово упаковывается, только когда известны все разности, которые могут в него войти
+    while (res == SUCCESS && pending.size() - next >= (final ? 1 : STEIM2_MAX_DIFFS)) {
+        int count = packWord(pending.data() + next, pending.size() - next);
+        if (count == 0) {
+            // Разность не помещается в 30 бит: следующая запись начинается заново
+            if (packed > 0) {
+                res = writeRecord();
+            }
+            continuous = false;
+            continue;
+        }
+        next += count;
+        if (frame == nframes) {
+            res = writeRecord();
+        }
+    }
+    if (res == SUCCESS && final && packed > 0) {
+        res = writeRecord();
+    }
+    if (res != SUCCESS) {
+        pending.clear();
+        return res;
+    }
+    pending.erase(pending.begin(), pending.begin() + next);
+    return SUCCESS;
+}
+
+/**
+ * Упаковка очередного слова Steim2: в слово помещается наибольшее число
+ * разностей, которое в него входит.
+ * @param x - отсчеты, ожидающие упаковки.
+ * @param n - число отсчетов.
+ * @return - число упакованных отсчетов (0, если первая разность не помещается в 30 бит).
+ */
+int MseedWriter::packWord(const int32_t *x, size_t n) {
+    int32_t prev = packed > 0 || continuous ? lastSample : x[0];
+    for (const SteimPack &p : STEIM2_PACKS) {
+        if ((size_t)p.count > n) {
+            continue;
+        }
+        int32_t lo = -(1 << (p.bits - 1)), hi = (1 << (p.bits - 1)) - 1;
+        bool fits = true;
+        for (int k = 0; k < p.count && fits; k++) {
+            int64_t d = (int64_t)x[k] - (k == 0 ? prev : x[k - 1]);
+            fits = d >= lo && d <= hi;
+        }
+        if (!fits) {
+            continue;
+        }
+        uint32_t w = p.dnib >= 0 ? (uint32_t)p.dnib << 30 : 0;
+        uint32_t mask = (1u << p.bits) - 1;
+        for (int k = 0; k < p.count; k++) {
+            int32_t d = x[k] - (k == 0 ? prev : x[k - 1]);
+            w |= ((uint32_t)d & mask) << (p.bits * (p.count - 1 - k));
+        }
+        uint8_t *f = record.data() + MSEED_HEADER_LEN + frame * STEIM_FRAME_LEN;
+        putBE32(f + word * 4, w);
+        ctrl |= p.nibble << (2 * (STEIM_FRAME_WORDS - 1 - word));
+        putBE32(f, ctrl);
+        if (packed == 0) {
+            firstSample = x[0];
+        }
+        packed += p.count;
+        lastSample = x[p.count - 1];
+        if (++word == STEIM_FRAME_WORDS) {
+            frame++;
+            word = 1;
+            ctrl = 0;
+        }
+        return p.count;
+    }
+    return 0;
+}
+
+/**
+ * Запись упакованных отсчетов в файл и начало следующей записи.
+ * @return - код ошибки.
+ */
+int8_t MseedWriter::writeRecord() {
+    int used = word > (frame == 0 ? 3 : 1) ? frame + 1 : frame;
+    putBE32(record.data() + MSEED_HEADER_LEN + 4, firstSample);
+    putBE32(record.data() + MSEED_HEADER_LEN + 8, lastSample);
+    fillHeader(packed, recordStart, used);
+
+    struct timeval tv;
+    tv.tv_sec = recordStart / 1000000;
+    tv.tv_usec = recordStart % 1000000;
+    if (file->prepare(&tv) < 0) {
+        continuous = false;
+        resetRecord();
+        return IO_FAILURE;
+    }
+    if (file->rotated() && file->size() % recLen != 0) {
+        // Недописанная при аварийном завершении запись заполняется нулями
+        std::vector<uint8_t> pad(recLen - file->size() % recLen, 0);
+        if (file->write(pad.data(), pad.size()) < 0) {
+            continuous = false;
+            resetRecord();
+            return IO_FAILURE;
+        }
+    }
+    if (file->write(record.data(), record.size()) < 0) {
+        logger->logging(ERROR, "Cannot write miniSEED record");
+        continuous = false;
+        resetRecord();
+        return IO_FAILURE;
+    }
+
+    continuous = true;
+    recordStart += llround(packed * 1000000.0 / rate);
+    resetRecord();
+    return SUCCESS;
+}
+
+/**
+ * Очистка кадров для следующей записи.
+ */
+void MseedWriter::resetRecord() {
+    memset(record.data(), 0, record.size());
+    packed = 0;
+    frame = 0;
+    word = 3;
+    ctrl = 0;
+}
+
+/**
+ * Заполнение заголовка записи: фиксированная часть, блокеты 1000 и 1001.
+ * @param n - число отсчетов в записи.
+ * @param startUsec - время первого отсчета (мкс от начала эпохи).
+ * @param nframes - число использованных кадров.
+ */
+void MseedWriter::fillHeader(size_t n, int64_t startUsec, int nframes) {
+    uint8_t *h = record.data();
+    sequence = sequence % 999999 + 1;
+    char seq[7];
+    snprintf(seq, sizeof(seq), "%06u", sequence);
+    memcpy(h, seq, 6);
+    h[6] = 'D';
+    h[7] = ' ';
+    memcpy(h + 8, code, 12);
+
+    // Время в десятитысячных долях секунды и поправка в микросекундах
+    int64_t ticks = (startUsec + 50) / 100;
+    int8_t micro = startUsec - ticks * 100;
+    time_t sec = ticks / 10000;
+    struct tm t;
+    gmtime_r(&sec, &t);
+    putBE16(h + 20, t.tm_year + 1900);
+    putBE16(h + 22, t.tm_yday + 1);
+    h[24] = t.tm_hour;
+    h[25] = t.tm_min;
+    h[26] = t.tm_sec;
+    h[27] = 0;
+    putBE16(h + 28, ticks % 10000);
+
+    putBE16(h + 30, n);
+    // Частота = factor / |multiplier| при отрицательном множителе
+    putBE16(h + 32, freq);
+    putBE16(h + 34, aver > 1 ? -(int16_t)aver : 1);
+    h[36] = 0;
+    h[37] = 0;
+    h[38] = 0;
+    h[39] = 2;
+    putBE32(h + 40, 0);
+    putBE16(h + 44, MSEED_HEADER_LEN);
+    putBE16(h + 46, 48);
+
+    // Blockette 1000: формат данных
+    putBE16(h + 48, 1000);
+    putBE16(h + 50, 56);
+    h[52] = MSEED_STEIM2;
+    h[53] = 1;
+    h[54] = recLen == 4096 ? 12 : 9;
+    h[55] = 0;
+
+    // Blockette 1001: микросекунды и число кадров
+    putBE16(h + 56, 1001);
+    putBE16(h + 58, 0);
+    h[60] = 0;
+    h[61] = (uint8_t)micro;
+    h[62] = 0;
+    h[63] = nframes;
+}
@@ -0,0 +1,94 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_MSEEDWRITER_H
+#define ADCCOLLECTOR_MSEEDWRITER_H
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <sys/time.h>
+#include "adcdefs.h"
+#include "logger.h"
+#include "rotatingfile.h"
+
+// Fixed section of data header plus blockettes 1000 and 1001
+#define MSEED_HEADER_LEN 64
+// Steim frame length (bytes) and words per frame
+#define STEIM_FRAME_LEN 64
+#define STEIM_FRAME_WORDS 16
+// Most differences packed into one Steim2 word
+#define STEIM2_MAX_DIFFS 7
+// Data encoding code of blockette 1000
+#define MSEED_STEIM2 11
+// A record is closed when it spans more than this (sec), so low rates still reach the disk
+#define MSEED_MAX_RECORD_SPAN 60
+
+/**
+ * Запись данных канала в формате miniSEED (SEED 2.4): записи фиксированной
+ * длины (512 или 4096 байт) с блокетами 1000 и 1001 и данными, сжатыми Steim2.
+ * Отсчеты записываются как 24-битные значения АЦП. Запись набирается
+ * непрерывно: каждое слово Steim2 упаковывается один раз, как только
+ * известны все разности, которые могут в него войти. Запись закрывается,
+ * когда кадры заполнены, при разрыве во времени, при смене часа и не реже
+ * раза в MSEED_MAX_RECORD_SPAN секунд.
+ */
+class MseedWriter {
+public:
+    MseedWriter(std::string root, uint8_t channel, bool oneFile, uint32_t flushInterval, int frequency,
+                uint16_t averaging, int recordLen, std::string network, std::string station, Logger *log,
+                std::string tag = "");
+    ~MseedWriter();
+
+    int8_t write(const int32_t *data, size_t len, const struct timeval *tv);
+    int8_t finish();
+    int8_t close();
+
+private:
+    bool dataInOneFile;
+    int freq;
+    uint16_t aver;
+    double rate;
+    int recLen;
+    char code[20];
+    Logger *logger;
+    std::unique_ptr<RotatingFile> file;
+
+    int nframes;
+    std::vector<int32_t> pending;
+    size_t packed = 0;
+    int frame = 0;
+    int word = 3;
+    uint32_t ctrl = 0;
+    int64_t recordStart = 0;
+    time_t recordHour = 0;
+    int32_t firstSample = 0;
+    int32_t lastSample = 0;
+    bool continuous = false;
+    uint32_t sequence = 0;
+    std::vector<uint8_t> record;
+
+    int8_t pack(bool final);
+    int packWord(const int32_t *x, size_t n);
+    int8_t writeRecord();
+    void resetRecord();
+    void fillHeader(size_t n, int64_t startUsec, int nframes);
+};
+
+
+#endif //ADCCOLLECTOR_MSEEDWRITER_H
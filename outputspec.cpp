@@ -0,0 +1,157 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "outputspec.h"
+#include "decimator.h"
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+
+/**
+ * Названия видов вывода в строке настроек.
+ */
+static const struct {
+    const char *name;
+    int format;
+} outputNames[] = {
+    {"blocks", BINARY_BLOCKS},
+    {"container", BINARY_CONTAINER},
+    {"mseed", BINARY_MSEED},
+    {"compressed", BINARY_COMPRESSED},
+    {"text", OUTPUT_TEXT}
+};
+
+/**
+ * Удаляет пробелы в начале и в конце строки.
+ * @param s - строка.
+ * @return - строка без пробелов по краям.
+ */
+static std::string trim(const std::string &s) {
+    size_t b = 0, e = s.size();
+    while (b < e && isspace((unsigned char)s[b])) {
+        b++;
+    }
+    while (e > b && isspace((unsigned char)s[e - 1])) {
+        e--;
+    }
+    return s.substr(b, e - b);
+}
+
+/**
+ * Разбор одного вывода вида <вид>[/<коэффициент>][:mean|:fir].
+ * @param item - описание вывода.
+ * @param spec - результат.
+ * @return - удалось ли разобрать описание.
+ */
+static bool parseOutputSpec(const std::string &item, OutputSpec *spec) {
+    std::string kind = item, factor, filter;
+    size_t colon = kind.find(':');
+    if (colon != std::string::npos) {
+        filter = trim(kind.substr(colon + 1));
+        kind = kind.substr(0, colon);
+    }
+    size_t slash = kind.find('/');
+    if (slash != std::string::npos) {
+        factor = trim(kind.substr(slash + 1));
+        kind = kind.substr(0, slash);
+    }
+    kind = trim(kind);
+
+    spec->format = -1;
+    for (const auto &out : outputNames) {
+        if (kind == out.name) {
+            spec->format = out.format;
+        }
+    }
+    if (spec->format < 0) {
+        return false;
+    }
+
+    spec->factor = 1;
+    if (!factor.empty()) {
+        char *end;
+        long f = strtol(factor.c_str(), &end, 10);
+        if (*end != '\0' || f < 1 || f > DECIMATION_MAX_FACTOR) {
+            return false;
+        }
+        spec->factor = (int)f;
+    }
+
+    spec->filter = DECIMATION_CIC_FIR;
+    if (filter == "mean") {
+        // Усреднение по блоку возможно, только если коэффициент делит длину блока
+        if (CHANBUF_LEN % spec->factor != 0) {
+            return false;
+        }
+        spec->filter = DECIMATION_MEAN;
+    } else if (!filter.empty() && filter != "fir") {
+        return false;
+    } else if (spec->factor > 1 && Decimator::firFactorFor(spec->factor) == 0) {
+        // Без делителя от FIR_MIN_FACTOR до FIR_MAX_FACTOR КИХ-фильтр вышел бы
+        // из десятков тысяч коэффициентов
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Разбор списка выводов канала, разделенных запятыми,
+ * например "container/32, text/800, blocks/4:mean".
+ * @param text - строка настроек.
+ * @param specs - разобранные выводы.
+ * @return - удалось ли разобрать всю строку.
+ */
+bool parseOutputSpecs(const std::string &text, std::vector<OutputSpec> *specs) {
+    specs->clear();
+    size_t pos = 0;
+    while (pos <= text.size()) {
+        size_t comma = text.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = text.size();
+        }
+        std::string item = trim(text.substr(pos, comma - pos));
+        pos = comma + 1;
+        if (item.empty()) {
+            continue;
+        }
+        OutputSpec spec;
+        if (!parseOutputSpec(item, &spec)) {
+            specs->clear();
+            return false;
+        }
+        specs->push_back(spec);
+    }
+    return true;
+}
+
+/**
+ * @param spec - вывод канала.
+ * @return - описание вывода в том же виде, что и в строке настроек.
+ */
+std::string outputSpecName(const OutputSpec &spec) {
+    std::string name;
+    for (const auto &out : outputNames) {
+        if (spec.format == out.format) {
+            name = out.name;
+        }
+    }
+    name += "/" + std::to_string(spec.factor);
+    if (spec.factor > 1 && spec.filter == DECIMATION_MEAN) {
+        name += ":mean";
+    }
+    return name;
+}
@@ -0,0 +1,40 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_OUTPUTSPEC_H
+#define ADCCOLLECTOR_OUTPUTSPEC_H
+#include <string>
+#include <vector>
+#include "adcdefs.h"
+
+// Output kind for text files (binary kinds are binaryFormats)
+#define OUTPUT_TEXT 16
+
+/**
+ * Описание одного вывода канала: вид файлов, во сколько раз
+ * понижается частота отсчетов (1 - полная частота) и фильтр.
+ */
+struct OutputSpec {
+    int format;
+    int factor;
+    int filter;
+};
+
+bool parseOutputSpecs(const std::string &text, std::vector<OutputSpec> *specs);
+std::string outputSpecName(const OutputSpec &spec);
+
+#endif //ADCCOLLECTOR_OUTPUTSPEC_H
@@ -0,0 +1,217 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "packetdecoder.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DECODER_X86
+#endif
+
+static_assert(NUM_CHANNELS == 4 && DATABUF_LEN == NUM_CHANNELS * CHANBUF_LEN * 4,
+              "Vector decoder expects 4 interleaved channels of CHANBUF_LEN samples per packet");
+
+#ifdef DECODER_X86
+/**
+ * Векторный разбор пакета (AVX2): за одну итерацию 8 кадров по 4 канала
+ * транспонируются в 4 вектора по 8 отсчетов одного канала.
+ * @return - false, если чередование каналов в пакете нарушено.
+ */
+__attribute__((target("avx2")))
+static bool decodeAvx2(const uint8_t *buf, int32_t (*ch)[CHANBUF_LEN],
+                       float (*voltsF)[CHANBUF_LEN], double (*voltsD)[CHANBUF_LEN]) {
+    const __m256i valueMask = _mm256_set1_epi32((int32_t)0xffffff00);
+    const __m256i chanMask = _mm256_set1_epi32(0xf0);
+    const __m256i chanPattern = _mm256_setr_epi32(0x00, 0x10, 0x20, 0x30, 0x00, 0x10, 0x20, 0x30);
+    const __m256i pairIdx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256 scaleF = _mm256_set1_ps((float)VOLTS_SCALE);
+    const __m256d scaleD = _mm256_set1_pd(VOLTS_SCALE);
+
+    // Проверка чередования каналов во всем пакете до записи результата
+    __m256i bad = _mm256_setzero_si256();
+    for (int i = 0; i < DATABUF_LEN; i += 32) {
+        __m256i w = _mm256_loadu_si256((const __m256i *)(buf + i));
+        bad = _mm256_or_si256(bad, _mm256_xor_si256(_mm256_and_si256(w, chanMask), chanPattern));
+    }
+    if (!_mm256_testz_si256(bad, bad)) {
+        return false;
+    }
+
+    for (int i = 0, j = 0; i < DATABUF_LEN; i += 128, j += 8) {
+        __m256i r0 = _mm256_loadu_si256((const __m256i *)(buf + i));
+        __m256i r1 = _mm256_loadu_si256((const __m256i *)(buf + i + 32));
+        __m256i r2 = _mm256_loadu_si256((const __m256i *)(buf + i + 64));
+        __m256i r3 = _mm256_loadu_si256((const __m256i *)(buf + i + 96));
+        // [a0 b0 c0 d0 a1 b1 c1 d1] -> [a0 a1 b0 b1 c0 c1 d0 d1]
+        r0 = _mm256_permutevar8x32_epi32(_mm256_and_si256(r0, valueMask), pairIdx);
+        r1 = _mm256_permutevar8x32_epi32(_mm256_and_si256(r1, valueMask), pairIdx);
+        r2 = _mm256_permutevar8x32_epi32(_mm256_and_si256(r2, valueMask), pairIdx);
+        r3 = _mm256_permutevar8x32_epi32(_mm256_and_si256(r3, valueMask), pairIdx);
+        // [a0..a3 | c0..c3], [b0..b3 | d0..d3]
+        __m256i lo01 = _mm256_unpacklo_epi64(r0, r1);
+        __m256i hi01 = _mm256_unpackhi_epi64(r0, r1);
+        __m256i lo23 = _mm256_unpacklo_epi64(r2, r3);
+        __m256i hi23 = _mm256_unpackhi_epi64(r2, r3);
+        __m256i out[NUM_CHANNELS];
+        out[0] = _mm256_permute2x128_si256(lo01, lo23, 0x20);
+        out[1] = _mm256_permute2x128_si256(hi01, hi23, 0x20);
+        out[2] = _mm256_permute2x128_si256(lo01, lo23, 0x31);
+        out[3] = _mm256_permute2x128_si256(hi01, hi23, 0x31);
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+            _mm256_storeu_si256((__m256i *)&ch[c][j], out[c]);
+            if (voltsF != nullptr) {
+                _mm256_storeu_ps(&voltsF[c][j], _mm256_mul_ps(_mm256_cvtepi32_ps(out[c]), scaleF));
+            }
+            if (voltsD != nullptr) {
+                __m256d lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(out[c]));
+                __m256d hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(out[c], 1));
+                _mm256_storeu_pd(&voltsD[c][j], _mm256_mul_pd(lo, scaleD));
+                _mm256_storeu_pd(&voltsD[c][j + 4], _mm256_mul_pd(hi, scaleD));
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Векторный разбор пакета (SSE2): за одну итерацию 4 кадра по 4 канала
+ * транспонируются в 4 вектора по 4 отсчета одного канала.
+ * @return - false, если чередование каналов в пакете нарушено.
+ */
+__attribute__((target("sse2")))
+static bool decodeSse2(const uint8_t *buf, int32_t (*ch)[CHANBUF_LEN],
+                       float (*voltsF)[CHANBUF_LEN], double (*voltsD)[CHANBUF_LEN]) {
+    const __m128i valueMask = _mm_set1_epi32((int32_t)0xffffff00);
+    const __m128i chanMask = _mm_set1_epi32(0xf0);
+    const __m128i chanPattern = _mm_setr_epi32(0x00, 0x10, 0x20, 0x30);
+    const __m128 scaleF = _mm_set1_ps((float)VOLTS_SCALE);
+    const __m128d scaleD = _mm_set1_pd(VOLTS_SCALE);
+
+    __m128i bad = _mm_setzero_si128();
+    for (int i = 0; i < DATABUF_LEN; i += 16) {
+        __m128i w = _mm_loadu_si128((const __m128i *)(buf + i));
+        bad = _mm_or_si128(bad, _mm_xor_si128(_mm_and_si128(w, chanMask), chanPattern));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(bad, _mm_setzero_si128())) != 0xffff) {
+        return false;
+    }
+
+    for (int i = 0, j = 0; i < DATABUF_LEN; i += 64, j += 4) {
+        __m128i r0 = _mm_and_si128(_mm_loadu_si128((const __m128i *)(buf + i)), valueMask);
+        __m128i r1 = _mm_and_si128(_mm_loadu_si128((const __m128i *)(buf + i + 16)), valueMask);
+        __m128i r2 = _mm_and_si128(_mm_loadu_si128((const __m128i *)(buf + i + 32)), valueMask);
+        __m128i r3 = _mm_and_si128(_mm_loadu_si128((const __m128i *)(buf + i + 48)), valueMask);
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+        __m128i out[NUM_CHANNELS];
+        out[0] = _mm_unpacklo_epi64(t0, t1);
+        out[1] = _mm_unpackhi_epi64(t0, t1);
+        out[2] = _mm_unpacklo_epi64(t2, t3);
+        out[3] = _mm_unpackhi_epi64(t2, t3);
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+            _mm_storeu_si128((__m128i *)&ch[c][j], out[c]);
+            if (voltsF != nullptr) {
+                _mm_storeu_ps(&voltsF[c][j], _mm_mul_ps(_mm_cvtepi32_ps(out[c]), scaleF));
+            }
+            if (voltsD != nullptr) {
+                _mm_storeu_pd(&voltsD[c][j], _mm_mul_pd(_mm_cvtepi32_pd(out[c]), scaleD));
+                _mm_storeu_pd(&voltsD[c][j + 2], _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(out[c], out[c])), scaleD));
+            }
+        }
+    }
+    return true;
+}
+#endif
+
+/**
+ * Конструктор. Выбор векторного варианта по возможностям процессора.
+ */
+PacketDecoder::PacketDecoder() {
+    vectorFn = nullptr;
+    isa = "scalar";
+#ifdef DECODER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        vectorFn = decodeAvx2;
+        isa = "avx2";
+    } else if (__builtin_cpu_supports("sse2")) {
+        vectorFn = decodeSse2;
+        isa = "sse2";
+    }
+#endif
+}
+
+/**
+ * Разбор пакета.
+ * @param buf - пакет длиной DATABUF_LEN.
+ * @param ch - отсчеты по каналам.
+ * @param voltsF - отсчеты в вольтах (float), может быть nullptr.
+ * @param voltsD - отсчеты в вольтах (double), может быть nullptr.
+ * @return - число слов с неверным номером канала или лишних слов.
+ */
+int PacketDecoder::decode(const uint8_t *buf, int32_t (*ch)[CHANBUF_LEN],
+                          float (*voltsF)[CHANBUF_LEN], double (*voltsD)[CHANBUF_LEN]) {
+    if (vectorFn != nullptr && vectorFn(buf, ch, voltsF, voltsD)) {
+        return 0;
+    }
+    int bad = decodeScalar(buf, ch);
+    for (int c = 0; c < NUM_CHANNELS; c++) {
+        for (int i = 0; i < CHANBUF_LEN; i++) {
+            if (voltsF != nullptr) {
+                voltsF[c][i] = (float)ch[c][i] * (float)VOLTS_SCALE;
+            }
+            if (voltsD != nullptr) {
+                voltsD[c][i] = (double)ch[c][i] * VOLTS_SCALE;
+            }
+        }
+    }
+    return bad;
+}
+
+/**
+ * @return - название используемого набора инструкций.
+ */
+const char *PacketDecoder::isaName() {
+    return isa;
+}
+
+/**
+ * Построчный разбор пакета с произвольным порядком каналов.
+ * Каналы, для которых пришло меньше CHANBUF_LEN отсчетов, дополняются нулями.
+ * @param buf - пакет длиной DATABUF_LEN.
+ * @param ch - отсчеты по каналам.
+ * @return - число слов с неверным номером канала или лишних слов.
+ */
+int PacketDecoder::decodeScalar(const uint8_t *buf, int32_t (*ch)[CHANBUF_LEN]) {
+    uint8_t ch_counter[NUM_CHANNELS] = {0, 0, 0, 0};
+    int bad = 0;
+    for (uint16_t i = 0; i < DATABUF_LEN; i += 4) {
+        int32_t data = (buf[i + 1] << 8) + (buf[i + 2] << 16) + ((uint32_t)buf[i + 3] << 24);
+        uint8_t chan = (buf[i] & 0xf0) >> 4;
+        if (chan < NUM_CHANNELS && ch_counter[chan] < CHANBUF_LEN) {
+            ch[chan][ch_counter[chan]++] = data;
+        } else {
+            bad++;
+        }
+    }
+    for (int c = 0; c < NUM_CHANNELS; c++) {
+        memset(&ch[c][ch_counter[c]], 0, (CHANBUF_LEN - ch_counter[c]) * sizeof(int32_t));
+    }
+    return bad;
+}
@@ -0,0 +1,53 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_PACKETDECODER_H
+#define ADCCOLLECTOR_PACKETDECODER_H
+#include <cstdint>
+#include <cstddef>
+#include "adcdefs.h"
+
+// Volts per ADC count
+#define VOLTS_SCALE (2.500 / 0x7fffff00)
+
+/**
+ * Разбор пакета АЦП ЛА-И24USB (DATABUF_LEN байт, слова по 4 байта:
+ * номер канала в старшей тетраде первого байта и 24-битный отсчет)
+ * в массивы отсчетов по каналам и, при необходимости, в вольты.
+ * Для пакетов с обычным чередованием каналов 0,1,2,3 используется
+ * векторный вариант (AVX2 или SSE2), выбранный при запуске по возможностям
+ * процессора, остальные пакеты разбираются построчно.
+ */
+class PacketDecoder {
+public:
+    PacketDecoder();
+
+    int decode(const uint8_t *buf, int32_t (*ch)[CHANBUF_LEN],
+               float (*voltsF)[CHANBUF_LEN] = nullptr, double (*voltsD)[CHANBUF_LEN] = nullptr);
+    const char *isaName();
+
+private:
+    typedef bool (*DecodeFn)(const uint8_t *, int32_t (*)[CHANBUF_LEN], float (*)[CHANBUF_LEN], double (*)[CHANBUF_LEN]);
+
+    DecodeFn vectorFn;
+    const char *isa;
+
+    static int decodeScalar(const uint8_t *buf, int32_t (*ch)[CHANBUF_LEN]);
+};
+
+
+#endif //ADCCOLLECTOR_PACKETDECODER_H
@@ -0,0 +1,327 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pyramid.h"
+#include "container.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+// Pyramid files mode
+#define PYRAMID_FILE_MODE 0644
+
+/**
+ * Имя файла пирамиды канала за час.
+ * @param root - каталог данных.
+ * @param hour - начало часа (сек от начала эпохи).
+ * @param channel - номер канала.
+ * @return - полное имя файла.
+ */
+std::string pyramidPath(const std::string &root, time_t hour, uint8_t channel) {
+    struct tm gt;
+    gmtime_r(&hour, &gt);
+    char name[PATH_LEN];
+    snprintf(name, PATH_LEN, "/%04d/%02d/%02d/%04d%02d%02d_%02d_%02d.pyr", gt.tm_year + 1900, gt.tm_mon + 1,
+             gt.tm_mday, gt.tm_year + 1900, gt.tm_mon + 1, gt.tm_mday, gt.tm_hour, channel);
+    return root + name;
+}
+
+/**
+ * Конструктор пирамиды канала.
+ * @param root - каталог данных.
+ * @param channel - номер канала.
+ * @param flushInterval - интервал записи текущих ячеек (сек).
+ * @param frequency - частота отсчетов.
+ * @param scale - множитель перевода отсчетов в вольты.
+ * @param log - журнал.
+ */
+PyramidWriter::PyramidWriter(std::string root, uint8_t channel, uint32_t flushInterval, int frequency,
+                             double scale, Logger *log) {
+    dataRoot = root;
+    chan = channel;
+    interval = flushInterval;
+    stepUsec = 1000000.0 / frequency;
+    voltsScale = scale;
+    logger = log;
+}
+
+/**
+ * Деструктор. Записывает текущие ячейки.
+ */
+PyramidWriter::~PyramidWriter() {
+    close();
+}
+
+/**
+ * Добавление отсчетов. Блок делится по границам секунд.
+ * @param data - отсчеты.
+ * @param len - число отсчетов.
+ * @param tv - время первого отсчета.
+ * @return - код ошибки.
+ */
+int8_t PyramidWriter::write(const int32_t *data, size_t len, const struct timeval *tv) {
+    int64_t usec = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    size_t i = 0;
+    while (i < len) {
+        time_t sec = (time_t)((usec + (int64_t)(i * stepUsec)) / 1000000);
+        size_t end = (size_t)ceil(((sec + 1) * 1000000.0 - usec) / stepUsec);
+        end = std::min(std::max(end, i + 1), len);
+        if (add(sec, data + i, end - i) != SUCCESS) {
+            return IO_FAILURE;
+        }
+        i = end;
+    }
+    if (tv->tv_sec - lastFlush >= (time_t)interval) {
+        lastFlush = tv->tv_sec;
+        return storeAll();
+    }
+    return SUCCESS;
+}
+
+/**
+ * Запись текущих ячеек и закрытие файла.
+ * @return - код ошибки.
+ */
+int8_t PyramidWriter::close() {
+    int8_t res = SUCCESS;
+    if (fd >= 0) {
+        res = storeAll();
+        ::close(fd);
+        fd = -1;
+    }
+    hourKey = -1;
+    return res;
+}
+
+/**
+ * Смещение ячейки в файле.
+ * @param hdr - заголовок файла.
+ * @param level - уровень пирамиды.
+ * @param bucket - номер ячейки от начала часа.
+ * @return - смещение (байт).
+ */
+size_t PyramidWriter::bucketOffset(const PyramidHeader &hdr, int level, size_t bucket) {
+    size_t offset = hdr.headerLen;
+    for (int k = 0; k < level; k++) {
+        offset += (3600 / hdr.bucketSec[k]) * sizeof(PyramidBucket);
+    }
+    return offset + bucket * sizeof(PyramidBucket);
+}
+
+/**
+ * Добавление отсчетов одной секунды во все уровни.
+ * @param sec - секунда (от начала эпохи).
+ * @param data - отсчеты.
+ * @param len - число отсчетов.
+ * @return - код ошибки.
+ */
+int8_t PyramidWriter::add(time_t sec, const int32_t *data, size_t len) {
+    time_t hour = sec - sec % 3600;
+    if (hour != hourKey && openHour(hour) != SUCCESS) {
+        return IO_FAILURE;
+    }
+    int32_t mn = data[0], mx = data[0];
+    int64_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        mn = std::min(mn, data[i]);
+        mx = std::max(mx, data[i]);
+        sum += data[i];
+    }
+    for (int l = 0; l < PYRAMID_LEVELS; l++) {
+        Level &lv = levels[l];
+        int64_t index = (sec - hour) / hdr.bucketSec[l];
+        if (index != lv.index) {
+            if (store(l) != SUCCESS) {
+                return IO_FAILURE;
+            }
+            // Ячейка могла быть начата до перезапуска
+            lv.index = index;
+            if (pread(fd, &lv.bucket, sizeof(lv.bucket), bucketOffset(hdr, l, index)) != sizeof(lv.bucket)) {
+                lv.bucket = PyramidBucket {};
+            }
+        }
+        PyramidBucket &b = lv.bucket;
+        b.min = b.count == 0 ? mn : std::min(b.min, mn);
+        b.max = b.count == 0 ? mx : std::max(b.max, mx);
+        b.sum += sum;
+        b.count += len;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Открытие файла пирамиды за час. Новый файл сразу получает полный размер
+ * с пустыми ячейками.
+ * @param hour - начало часа.
+ * @return - код ошибки.
+ */
+int8_t PyramidWriter::openHour(time_t hour) {
+    if (close() != SUCCESS) {
+        return IO_FAILURE;
+    }
+    std::string path = pyramidPath(dataRoot, hour, chan);
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, PYRAMID_FILE_MODE);
+    if (fd < 0) {
+        logger->logging(ERROR, "Cannot open pyramid file");
+        return IO_FAILURE;
+    }
+
+    static const uint32_t bucketSec[PYRAMID_LEVELS] = PYRAMID_BUCKETS_SEC;
+    PyramidHeader fresh {};
+    memcpy(fresh.magic, PYRAMID_MAGIC, sizeof(fresh.magic));
+    fresh.version = PYRAMID_VERSION;
+    fresh.headerLen = sizeof(PyramidHeader);
+    fresh.levels = PYRAMID_LEVELS;
+    fresh.channel = chan;
+    fresh.hourStart = hour;
+    fresh.scale = voltsScale;
+    memcpy(fresh.bucketSec, bucketSec, sizeof(bucketSec));
+    fresh.crc = crc32(&fresh, offsetof(PyramidHeader, crc));
+
+    if (pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || memcmp(&hdr, &fresh, sizeof(hdr)) != 0) {
+        // Новый или непригодный файл создается заново
+        hdr = fresh;
+        size_t fileLen = bucketOffset(hdr, PYRAMID_LEVELS, 0);
+        if (ftruncate(fd, 0) < 0 || ftruncate(fd, fileLen) < 0 ||
+            pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr)) {
+            logger->logging(ERROR, "Cannot write pyramid file header");
+            ::close(fd);
+            fd = -1;
+            return IO_FAILURE;
+        }
+    }
+    for (Level &lv : levels) {
+        lv.index = -1;
+    }
+    hourKey = hour;
+    return SUCCESS;
+}
+
+/**
+ * Запись текущей ячейки уровня на ее место в файле.
+ * @param level - уровень пирамиды.
+ * @return - код ошибки.
+ */
+int8_t PyramidWriter::store(int level) {
+    Level &lv = levels[level];
+    if (fd < 0 || lv.index < 0 || lv.bucket.count == 0) {
+        return SUCCESS;
+    }
+    if (pwrite(fd, &lv.bucket, sizeof(lv.bucket), bucketOffset(hdr, level, lv.index)) != sizeof(lv.bucket)) {
+        logger->logging(ERROR, "Cannot write pyramid bucket");
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Запись текущих ячеек всех уровней.
+ * @return - код ошибки.
+ */
+int8_t PyramidWriter::storeAll() {
+    for (int l = 0; l < PYRAMID_LEVELS; l++) {
+        if (store(l) != SUCCESS) {
+            return IO_FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Конструктор чтения пирамиды.
+ */
+PyramidReader::PyramidReader() = default;
+
+/**
+ * Деструктор. Закрывает файл.
+ */
+PyramidReader::~PyramidReader() {
+    close();
+}
+
+/**
+ * Открытие файла пирамиды.
+ * @param fileName - имя файла.
+ * @return - код ошибки.
+ */
+int8_t PyramidReader::open(const std::string &fileName) {
+    close();
+    fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return IO_FAILURE;
+    }
+    if (pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) ||
+        memcmp(hdr.magic, PYRAMID_MAGIC, sizeof(hdr.magic)) != 0 || hdr.version != PYRAMID_VERSION ||
+        hdr.levels != PYRAMID_LEVELS || hdr.crc != crc32(&hdr, offsetof(PyramidHeader, crc))) {
+        close();
+        return IO_FAILURE;
+    }
+    for (uint32_t sec : hdr.bucketSec) {
+        if (sec == 0 || 3600 % sec != 0) {
+            close();
+            return IO_FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Закрытие файла.
+ */
+void PyramidReader::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+/**
+ * @return - заголовок файла.
+ */
+const PyramidHeader &PyramidReader::header() {
+    return hdr;
+}
+
+/**
+ * Чтение подряд идущих ячеек уровня одним вызовом.
+ * @param level - уровень пирамиды.
+ * @param first - номер первой ячейки от начала часа.
+ * @param count - число ячеек (ограничивается концом часа).
+ * @param buckets - ячейки.
+ * @return - код ошибки.
+ */
+int8_t PyramidReader::read(int level, size_t first, size_t count, std::vector<PyramidBucket> *buckets) {
+    if (fd < 0 || level < 0 || level >= PYRAMID_LEVELS) {
+        return IO_FAILURE;
+    }
+    size_t total = 3600 / hdr.bucketSec[level];
+    count = first < total ? std::min(count, total - first) : 0;
+    buckets->resize(count);
+    ssize_t len = count * sizeof(PyramidBucket);
+    if (pread(fd, buckets->data(), len, PyramidWriter::bucketOffset(hdr, level, first)) != len) {
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
@@ -0,0 +1,138 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_PYRAMID_H
+#define ADCCOLLECTOR_PYRAMID_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+#include <sys/time.h>
+#include "adcdefs.h"
+#include "logger.h"
+
+// Pyramid file signature and version
+#define PYRAMID_MAGIC "ADCPYRMD"
+#define PYRAMID_VERSION 1
+// Number of pyramid levels and bucket length of each level (sec)
+#define PYRAMID_LEVELS 4
+#define PYRAMID_BUCKETS_SEC {1, 10, 60, 600}
+
+/**
+ * Заголовок файла пирамиды (64 байта). Файл описывает один час одного канала:
+ * после заголовка идут уровни пирамиды, в каждом - по ячейке на каждый
+ * интервал часа. Смещение ячейки вычисляется по ее времени, поэтому
+ * чтение грубого уровня - это одно чтение нескольких сотен байт.
+ */
+struct PyramidHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t headerLen;
+    uint16_t levels;
+    uint8_t channel;
+    uint8_t reserved1;
+    int64_t hourStart;
+    double scale;
+    uint32_t bucketSec[PYRAMID_LEVELS];
+    uint8_t reserved2[12];
+    uint32_t crc;
+};
+
+/**
+ * Ячейка пирамиды (24 байта). Пустая ячейка имеет count = 0.
+ * Среднее - sum / count, сумма позволяет объединять ячейки без потерь.
+ */
+struct PyramidBucket {
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(PyramidHeader) == 64, "pyramid header must be 64 bytes");
+static_assert(sizeof(PyramidBucket) == 24, "pyramid bucket must be 24 bytes");
+
+/**
+ * Ведение пирамиды минимумов, максимумов и средних канала
+ * (YYYY/MM/DD/YYYYMMDD_HH_CC.pyr) по мере записи данных. Ячейки текущих
+ * интервалов держатся в памяти и записываются на свое место в файле
+ * при переходе к следующему интервалу и не реже раза в flushInterval секунд.
+ * При повторном открытии файла того же часа ячейки дополняются.
+ */
+class PyramidWriter {
+public:
+    PyramidWriter(std::string root, uint8_t channel, uint32_t flushInterval, int frequency, double scale,
+                  Logger *log);
+    ~PyramidWriter();
+
+    int8_t write(const int32_t *data, size_t len, const struct timeval *tv);
+    int8_t close();
+
+    static size_t bucketOffset(const PyramidHeader &hdr, int level, size_t bucket);
+
+private:
+    /**
+     * Текущая ячейка уровня.
+     */
+    struct Level {
+        int64_t index = -1;
+        PyramidBucket bucket {};
+    };
+
+    std::string dataRoot;
+    uint8_t chan;
+    uint32_t interval;
+    double stepUsec;
+    double voltsScale;
+    Logger *logger;
+
+    int fd = -1;
+    PyramidHeader hdr {};
+    time_t hourKey = -1;
+    time_t lastFlush = 0;
+    Level levels[PYRAMID_LEVELS];
+
+    int8_t add(time_t sec, const int32_t *data, size_t len);
+    int8_t openHour(time_t hour);
+    int8_t store(int level);
+    int8_t storeAll();
+};
+
+/**
+ * Чтение ячеек пирамиды за часть часа.
+ */
+class PyramidReader {
+public:
+    PyramidReader();
+    ~PyramidReader();
+
+    int8_t open(const std::string &fileName);
+    void close();
+    const PyramidHeader &header();
+    int8_t read(int level, size_t first, size_t count, std::vector<PyramidBucket> *buckets);
+
+private:
+    int fd = -1;
+    PyramidHeader hdr {};
+};
+
+std::string pyramidPath(const std::string &root, time_t hour, uint8_t channel);
+
+
+#endif //ADCCOLLECTOR_PYRAMID_H
@@ -0,0 +1,179 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "replaydevice.h"
+#include "adcdefs.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+/**
+ * Конструктор воспроизведения.
+ * @param log - журнал.
+ * @param fileName - файл захвата.
+ * @param realtime - выдавать запросы с исходной скоростью (иначе без задержек).
+ */
+ReplayDevice::ReplayDevice(Logger *log, std::string fileName, bool realtime) : reader(log) {
+    logger = log;
+    captureName = fileName;
+    paced = realtime;
+}
+
+/**
+ * Открытие файла захвата.
+ * @return - код ошибки.
+ */
+int8_t ReplayDevice::open() {
+    std::string msg = "Replay capture " + captureName;
+    logger->logging(INFO, msg.c_str());
+    if (reader.open(captureName) != SUCCESS) {
+        return ADC_OPEN_ERROR;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Запуск воспроизведения.
+ * @param frequency - частота дискретизации (Гц).
+ * @param transferSize - размер одного запроса (байт).
+ * @param timeout - таймаут одного запроса (msec).
+ * @param interval - ожидаемый интервал между запросами (msec).
+ * @return - код ошибки.
+ */
+int8_t ReplayDevice::start(int frequency, int transferSize, uint32_t /*timeout*/, uint32_t /*interval*/) {
+    if ((uint32_t)frequency != reader.frequency()) {
+        char msg[128];
+        snprintf(msg, 128, "Replay: capture frequency %u Hz differs from configured %d Hz",
+                 reader.frequency(), frequency);
+        logger->logging(WARN, msg);
+    }
+    size = std::max(transferSize - transferSize % DATABUF_LEN, DATABUF_LEN);
+    pending.clear();
+    offset = 0;
+    first = true;
+    stats = DeviceStats {};
+    running = true;
+    return SUCCESS;
+}
+
+/**
+ * Выдача очередного запроса из файла захвата.
+ * @param buf - выходной буфер (не меньше размера запроса).
+ * @param len - число выданных байт.
+ * @param tv - время приема.
+ * @param timeout - время ожидания (msec).
+ * @return - код ошибки, END_OF_DATA в конце файла.
+ */
+int8_t ReplayDevice::read(uint8_t *buf, int *len, struct timeval *tv, uint32_t timeout) {
+    *len = 0;
+    if (!running) {
+        return ADC_FAILURE;
+    }
+    while (offset >= pending.size()) {
+        int8_t res = reader.next(&pending, &recordTv);
+        if (res != SUCCESS) {
+            // Поврежденный файл воспроизводится до первой ошибки
+            return END_OF_DATA;
+        }
+        offset = 0;
+        stats.completed++;
+        // Неполный последний пакет запроса отбрасывается, чтобы воспроизведение
+        // не уходило в перезапуск сбора и не дублировало уже записанные данные
+        if (pending.size() % DATABUF_LEN != 0) {
+            stats.shortTransfers++;
+            pending.resize(pending.size() - pending.size() % DATABUF_LEN);
+        }
+        if (paced) {
+            wait(timeout);
+        }
+    }
+
+    // Часть запроса выдается со временем своего последнего пакета
+    size_t chunk = std::min(pending.size() - offset, (size_t)size);
+    memcpy(buf, pending.data() + offset, chunk);
+    offset += chunk;
+    *len = chunk;
+    uint64_t after = (pending.size() - offset) / DATABUF_LEN * CHANBUF_LEN;
+    int64_t usec = (int64_t)recordTv.tv_sec * 1000000 + recordTv.tv_usec;
+    if (reader.frequency() > 0) {
+        usec -= after * 1000000 / reader.frequency();
+    }
+    tv->tv_sec = usec / 1000000;
+    tv->tv_usec = usec % 1000000;
+    return SUCCESS;
+}
+
+/**
+ * Остановка воспроизведения.
+ * @return - код ошибки.
+ */
+int8_t ReplayDevice::stop() {
+    running = false;
+    return SUCCESS;
+}
+
+/**
+ * Закрытие файла захвата.
+ */
+void ReplayDevice::close() {
+    stop();
+    reader.close();
+}
+
+/**
+ * @return - произошла ли неисправимая ошибка чтения.
+ */
+bool ReplayDevice::failed() {
+    return false;
+}
+
+/**
+ * @return - счетчики чтения.
+ */
+DeviceStats ReplayDevice::getStats() {
+    return stats;
+}
+
+/**
+ * @return - название устройства.
+ */
+const char *ReplayDevice::name() {
+    return paced ? "replay" : "replay (max speed)";
+}
+
+/**
+ * Ожидание момента приема текущего запроса относительно первого.
+ * Перерывы в записи длиннее таймаута сокращаются до таймаута.
+ * @param timeout - наибольшее время ожидания (msec).
+ */
+void ReplayDevice::wait(uint32_t timeout) {
+    int64_t usec = (int64_t)recordTv.tv_sec * 1000000 + recordTv.tv_usec;
+    auto now = std::chrono::steady_clock::now();
+    if (first) {
+        first = false;
+        firstUsec = usec;
+        startTime = now;
+        return;
+    }
+    auto due = startTime + std::chrono::microseconds(usec - firstUsec);
+    auto limit = now + std::chrono::milliseconds(timeout);
+    if (due > limit) {
+        startTime -= due - limit;
+        due = limit;
+    }
+    std::this_thread::sleep_until(due);
+}
@@ -0,0 +1,64 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_REPLAYDEVICE_H
+#define ADCCOLLECTOR_REPLAYDEVICE_H
+#include <chrono>
+#include <string>
+#include <vector>
+#include "adcdevice.h"
+#include "capturefile.h"
+#include "logger.h"
+
+/**
+ * Воспроизведение файла захвата вместо чтения с АЦП. Запросы выдаются
+ * с исходными временами приема, с исходной скоростью или без задержек.
+ * Запросы больше текущего размера запроса выдаются частями.
+ */
+class ReplayDevice : public AdcDevice {
+public:
+    ReplayDevice(Logger *log, std::string fileName, bool realtime);
+
+    int8_t open() override;
+    int8_t start(int frequency, int transferSize, uint32_t timeout, uint32_t interval) override;
+    int8_t read(uint8_t *buf, int *len, struct timeval *tv, uint32_t timeout) override;
+    int8_t stop() override;
+    void close() override;
+    bool failed() override;
+    DeviceStats getStats() override;
+    const char *name() override;
+
+private:
+    Logger *logger;
+    std::string captureName;
+    bool paced;
+    CaptureReader reader;
+    bool running = false;
+    int size = 0;
+    std::vector<uint8_t> pending;
+    size_t offset = 0;
+    struct timeval recordTv {};
+    bool first = true;
+    int64_t firstUsec = 0;
+    std::chrono::steady_clock::time_point startTime;
+    DeviceStats stats {};
+
+    void wait(uint32_t timeout);
+};
+
+
+#endif //ADCCOLLECTOR_REPLAYDEVICE_H
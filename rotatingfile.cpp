@@ -0,0 +1,209 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rotatingfile.h"
+#include <cstring>
+#include <errno.h>
+
+/**
+ * Конструктор файла данных канала.
+ * @param root - корневой каталог данных.
+ * @param hourlySuffix - окончание имени часового файла (например, ".01").
+ * @param oneFileName - имя файла в режиме записи в один файл.
+ * @param oneFile - записывать все данные в один файл.
+ * @param flushInterval - интервал сброса буфера на диск (сек), 0 - после каждой записи.
+ * @param log - журнал.
+ */
+RotatingFile::RotatingFile(std::string root, std::string hourlySuffix, std::string oneFileName, bool oneFile,
+                           uint32_t flushInterval, Logger *log) {
+    dataRoot = root;
+    suffix = hourlySuffix;
+    singleName = oneFileName;
+    dataInOneFile = oneFile;
+    interval = flushInterval;
+    logger = log;
+    buf.resize(FILE_BUF_LEN);
+}
+
+/**
+ * Деструктор. Сбрасывает буфер и закрывает файл.
+ */
+RotatingFile::~RotatingFile() {
+    close();
+}
+
+/**
+ * Подготовка файла к записи блока с заданным временем: при смене часа
+ * закрывается старый и открывается новый файл, при истечении интервала
+ * сбрасывается буфер.
+ * @param tv - время блока.
+ * @return - код ошибки.
+ */
+int8_t RotatingFile::prepare(const struct timeval *tv) {
+    newFile = false;
+    time_t hour = dataInOneFile ? 0 : tv->tv_sec / 3600;
+    if (f == NULL || hour != hourKey) {
+        if (close() != SUCCESS) {
+            return IO_FAILURE;
+        }
+        const uint16_t FULL_NAME_LEN = PATH_LEN + FILE_LEN + 1;
+        char full_name[FULL_NAME_LEN];
+        if (!dataInOneFile) {
+            time_t time_sec = tv->tv_sec;
+            struct tm gt;
+            gmtime_r(&time_sec, &gt);
+            char file_path[PATH_LEN];
+            snprintf(file_path, PATH_LEN, "%s/%04d/%02d/%02d", dataRoot.c_str(),
+                     gt.tm_year + 1900, gt.tm_mon + 1, gt.tm_mday);
+            time_t day = tv->tv_sec / 86400;
+            if (day != dayKey) {
+                if (mkdirs(file_path, PATH_LEN, DIR_MODE) < 0) {
+                    return IO_FAILURE;
+                }
+                dayKey = day;
+            }
+            snprintf(full_name, FULL_NAME_LEN, "%s/%04d%02d%02d_%02d%s", file_path,
+                     gt.tm_year + 1900, gt.tm_mon + 1, gt.tm_mday, gt.tm_hour, suffix.c_str());
+        } else {
+            snprintf(full_name, FULL_NAME_LEN, "%s/%s", dataRoot.c_str(), singleName.c_str());
+        }
+        if (open(full_name) < 0) {
+            return IO_FAILURE;
+        }
+        hourKey = hour;
+        lastFlush = tv->tv_sec;
+        newFile = true;
+    } else if (tv->tv_sec - lastFlush >= (time_t)interval) {
+        lastFlush = tv->tv_sec;
+        return flush();
+    }
+    return SUCCESS;
+}
+
+/**
+ * Запись данных в буфер файла. Без интервала сброса данные сразу сбрасываются на диск.
+ * @param data - данные.
+ * @param len - длина данных (байт).
+ * @return - код ошибки.
+ */
+int8_t RotatingFile::write(const void *data, size_t len) {
+    if (f == NULL) {
+        return IO_FAILURE;
+    }
+    if (fwrite(data, 1, len, f) != len) {
+        logger->logging(ERROR, "Cannot write data to file");
+        return IO_FAILURE;
+    }
+    if (interval == 0) {
+        return flush();
+    }
+    return SUCCESS;
+}
+
+/**
+ * Сброс буфера на диск.
+ * @return - код ошибки.
+ */
+int8_t RotatingFile::flush() {
+    if (f != NULL && fflush(f) != 0) {
+        logger->logging(ERROR, "Cannot flush data file");
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Закрытие файла со сбросом буфера на диск.
+ * @return - код ошибки.
+ */
+int8_t RotatingFile::close() {
+    if (f == NULL) {
+        return SUCCESS;
+    }
+    int res = fclose(f);
+    f = NULL;
+    if (res != 0) {
+        logger->logging(ERROR, "Cannot close data file");
+        return IO_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @return - был ли открыт новый файл при последнем вызове prepare().
+ */
+bool RotatingFile::rotated() {
+    return newFile;
+}
+
+/**
+ * @return - текущий размер файла с учетом буфера (байт).
+ */
+long RotatingFile::size() {
+    return f != NULL ? ftell(f) : -1;
+}
+
+/**
+ * @return - полное имя открытого файла.
+ */
+std::string RotatingFile::path() {
+    return currentPath;
+}
+
+/**
+ * Открытие файла на дозапись с большим буфером.
+ * @param fileName - полное имя файла.
+ * @return - код ошибки.
+ */
+int8_t RotatingFile::open(const char *fileName) {
+    f = fopen(fileName, "a");
+    if (!f) {
+        logger->logging(ERROR, "Cannot open a file for writing");
+        return IO_FAILURE;
+    }
+    setvbuf(f, buf.data(), _IOFBF, buf.size());
+    fseek(f, 0, SEEK_END);
+    currentPath = fileName;
+    return SUCCESS;
+}
+
+/**
+ * Создание каталогов для сохранения данных.
+ * @param path - корневой путь.
+ * @param path_len - длина пути.
+ * @param mode - режим создания.
+ * @return - код ошибки.
+ */
+int8_t RotatingFile::mkdirs(const char *path, const u_int16_t path_len, mode_t mode) {
+    char buf[PATH_LEN];
+    size_t len = strnlen(path, path_len < PATH_LEN ? path_len : PATH_LEN - 1);
+
+    // Split path to pieces by delimiters ('/') and make directories
+    for (size_t i = 1; i <= len; i++) {
+        if (i == len || path[i] == '/') {
+            memcpy(buf, path, i);
+            buf[i] = '\0';
+            int res = mkdir(buf, mode);
+            if (res < 0 && errno != EEXIST) {
+                logger->logging(ERROR, "Cannot make a directory for writing data");
+                return IO_FAILURE;
+            }
+        }
+    }
+
+    return SUCCESS;
+}
@@ -0,0 +1,78 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_ROTATINGFILE_H
+#define ADCCOLLECTOR_ROTATINGFILE_H
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <ctime>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include "adcdefs.h"
+#include "logger.h"
+
+// User-space buffer of an open data file
+#define FILE_BUF_LEN (1 << 20)
+// Data directories mode
+#define DIR_MODE (S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)
+
+/**
+ * Файл данных одного канала, который остается открытым в течение часа.
+ * Новый файл YYYY/MM/DD/YYYYMMDD_HH<suffix> открывается при смене часа,
+ * каталоги создаются только при смене дня. Запись буферизуется,
+ * буфер сбрасывается на диск не чаще, чем раз в flushInterval секунд.
+ */
+class RotatingFile {
+public:
+    RotatingFile(std::string root, std::string hourlySuffix, std::string oneFileName, bool oneFile,
+                 uint32_t flushInterval, Logger *log);
+    ~RotatingFile();
+
+    int8_t prepare(const struct timeval *tv);
+    int8_t write(const void *data, size_t len);
+    int8_t flush();
+    int8_t close();
+    bool rotated();
+    long size();
+    std::string path();
+
+    int8_t mkdirs(const char *path, const u_int16_t path_len, mode_t mode);
+
+private:
+    std::string dataRoot;
+    std::string suffix;
+    std::string singleName;
+    bool dataInOneFile;
+    uint32_t interval;
+    Logger *logger;
+
+    FILE *f = NULL;
+    std::vector<char> buf;
+    std::string currentPath;
+    time_t hourKey = -1;
+    time_t dayKey = -1;
+    time_t lastFlush = 0;
+    bool newFile = false;
+
+    int8_t open(const char *fileName);
+};
+
+
+#endif //ADCCOLLECTOR_ROTATINGFILE_H
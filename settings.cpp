@@ -34,6 +34,9 @@ void Settings::saveChannelSettings(ChannelView *channelView, int numberOfChannel
     settings.setValue("color_of_grid", channelView->colorOfGrid);
     settings.setValue("save_binary_data", channelView->saveBinaryData);
     settings.setValue("save_text_data", channelView->saveTextData);
+    settings.setValue("binary_format", channelView->binaryFormat);
+    settings.setValue("decimation_filter", channelView->decimationFilter);
+    settings.setValue("extra_outputs", channelView->extraOutputs);
 }
 
 /**
@@ -52,6 +55,9 @@ ChannelView Settings::loadChannelSettings(int numberOfChannel) {
     channelView.colorOfGrid = settings.value(group + "/color_of_grid", colorOfGrid).value<QColor>();
     channelView.saveBinaryData = settings.value(group + "/save_binary_data", true).toBool();
     channelView.saveTextData = settings.value(group + "/save_text_data", true).toBool();
+    channelView.binaryFormat = settings.value(group + "/binary_format", 0).toInt();
+    channelView.decimationFilter = settings.value(group + "/decimation_filter", 0).toInt();
+    channelView.extraOutputs = settings.value(group + "/extra_outputs", "").toString();
 
     return channelView;
 }
@@ -71,6 +77,22 @@ void Settings::saveGlobalSettings(GlobalView *globalView) {
     settings.setValue("meaning_data_buffer", globalView->meaningDataBuffer);
     settings.setValue("data_in_one_file", globalView->dataInOneFile);
     settings.setValue("autostart", globalView->autoStart);
+    settings.setValue("usb_queue_depth", globalView->usbQueueDepth);
+    settings.setValue("usb_transfer_size", globalView->usbTransferSize);
+    settings.setValue("flush_interval", globalView->flushInterval);
+    settings.setValue("text_time_precision", globalView->textTimePrecision);
+    settings.setValue("device_type", globalView->deviceType);
+    settings.setValue("sim_short_reads", globalView->simShortReads);
+    settings.setValue("sim_timeouts", globalView->simTimeouts);
+    settings.setValue("sim_bad_channels", globalView->simBadChannels);
+    settings.setValue("record_capture", globalView->recordCapture);
+    settings.setValue("replay_file", globalView->replayFile);
+    settings.setValue("mseed_record_len", globalView->mseedRecordLen);
+    settings.setValue("mseed_network", globalView->mseedNetwork);
+    settings.setValue("mseed_station", globalView->mseedStation);
+    settings.setValue("max_fps", globalView->maxFps);
+    settings.setValue("spectrum_length", globalView->spectrumLength);
+    settings.setValue("spectrum_overlap", globalView->spectrumOverlap);
 }
 
 /**
@@ -87,6 +109,22 @@ GlobalView Settings::loadGlobalSettings() {
     globalView.meaningDataBuffer = settings.value(group + "/meaning_data_buffer", 0).toInt();
     globalView.dataInOneFile = settings.value(group + "/data_in_one_file", false).toBool();
     globalView.autoStart = settings.value(group + "/autostart", false).toBool();
+    globalView.usbQueueDepth = settings.value(group + "/usb_queue_depth", 8).toInt();
+    globalView.usbTransferSize = settings.value(group + "/usb_transfer_size", 512).toInt();
+    globalView.flushInterval = settings.value(group + "/flush_interval", 5).toInt();
+    globalView.textTimePrecision = settings.value(group + "/text_time_precision", 3).toInt();
+    globalView.deviceType = settings.value(group + "/device_type", 0).toInt();
+    globalView.simShortReads = settings.value(group + "/sim_short_reads", 0).toInt();
+    globalView.simTimeouts = settings.value(group + "/sim_timeouts", 0).toInt();
+    globalView.simBadChannels = settings.value(group + "/sim_bad_channels", 0).toInt();
+    globalView.recordCapture = settings.value(group + "/record_capture", false).toBool();
+    globalView.replayFile = settings.value(group + "/replay_file", "").toString();
+    globalView.mseedRecordLen = settings.value(group + "/mseed_record_len", 512).toInt();
+    globalView.mseedNetwork = settings.value(group + "/mseed_network", "XX").toString();
+    globalView.mseedStation = settings.value(group + "/mseed_station", "ADC").toString();
+    globalView.maxFps = settings.value(group + "/max_fps", 30).toInt();
+    globalView.spectrumLength = settings.value(group + "/spectrum_length", 1024).toInt();
+    globalView.spectrumOverlap = settings.value(group + "/spectrum_overlap", 50).toInt();
     return globalView;
 }
 
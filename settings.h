@@ -40,6 +40,22 @@ struct GlobalView {
     int meaningDataBuffer;
     bool dataInOneFile;
     bool autoStart;
+    int usbQueueDepth;
+    int usbTransferSize;
+    int flushInterval;
+    int textTimePrecision;
+    int deviceType;
+    int simShortReads;
+    int simTimeouts;
+    int simBadChannels;
+    bool recordCapture;
+    QString replayFile;
+    int mseedRecordLen;
+    QString mseedNetwork;
+    QString mseedStation;
+    int maxFps;
+    int spectrumLength;
+    int spectrumOverlap;
 };
 
 /**
@@ -53,6 +69,9 @@ struct ChannelView {
     bool enabled;
     bool saveBinaryData;
     bool saveTextData;
+    int binaryFormat;
+    int decimationFilter;
+    QString extraOutputs;
 };
 
 /**
@@ -0,0 +1,198 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "simdevice.h"
+#include "adcdefs.h"
+#include <cmath>
+#include <thread>
+
+/**
+ * Конструктор имитатора.
+ * @param log - журнал.
+ * @param realtime - выдавать данные с частотой дискретизации (иначе с максимальной скоростью).
+ * @param faults - частота внесения ошибок.
+ */
+SimDevice::SimDevice(Logger *log, bool realtime, SimFaults faults) : rng(1) {
+    logger = log;
+    paced = realtime;
+    simFaults = faults;
+    table.resize(SIM_TABLE_LEN);
+    for (int i = 0; i < SIM_TABLE_LEN; i++) {
+        table[i] = (int32_t)lround(SIM_AMPLITUDE * sin(2 * M_PI * i / SIM_TABLE_LEN));
+    }
+}
+
+/**
+ * Открытие имитатора.
+ * @return - код ошибки.
+ */
+int8_t SimDevice::open() {
+    logger->logging(INFO, paced ? "Open ADC simulator (realtime)" : "Open ADC simulator (max speed)");
+    return SUCCESS;
+}
+
+/**
+ * Запуск формирования данных.
+ * @param frequency - частота дискретизации (Гц).
+ * @param transferSize - размер одного запроса (байт).
+ * @param timeout - таймаут одного запроса (msec).
+ * @param interval - ожидаемый интервал между запросами (msec).
+ * @return - код ошибки.
+ */
+int8_t SimDevice::start(int frequency, int transferSize, uint32_t /*timeout*/, uint32_t /*interval*/) {
+    if (frequency <= 0 || transferSize < DATABUF_LEN) {
+        logger->logging(FATAL, "Simulator: wrong frequency or transfer size");
+        return ADC_FAILURE;
+    }
+    freq = frequency;
+    size = transferSize - transferSize % DATABUF_LEN;
+    transfers = 0;
+    samples = 0;
+    stats = DeviceStats {};
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    startUsec = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    startTime = std::chrono::steady_clock::now();
+    running = true;
+    return SUCCESS;
+}
+
+/**
+ * Формирование очередного запроса. В режиме реального времени
+ * ожидает момента, когда запрос был бы принят с устройства.
+ * @param buf - выходной буфер (не меньше размера запроса).
+ * @param len - число сформированных байт.
+ * @param tv - время последнего отсчета запроса.
+ * @param timeout - время ожидания (msec).
+ * @return - код ошибки.
+ */
+int8_t SimDevice::read(uint8_t *buf, int *len, struct timeval *tv, uint32_t timeout) {
+    *len = 0;
+    if (!running) {
+        return ADC_FAILURE;
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    uint64_t transferSamples = (uint64_t)size / DATABUF_LEN * CHANBUF_LEN;
+    while (true) {
+        uint64_t endSamples = samples + transferSamples;
+        if (paced) {
+            auto due = startTime + std::chrono::microseconds(endSamples * 1000000 / freq);
+            if (due > deadline) {
+                std::this_thread::sleep_until(deadline);
+                return ADC_FAILURE;
+            }
+            std::this_thread::sleep_until(due);
+        }
+        transfers++;
+        if (fault(simFaults.timeouts)) {
+            // Данные запроса потеряны
+            stats.timeouts++;
+            samples = endSamples;
+            continue;
+        }
+        for (int p = 0; p < size / DATABUF_LEN; p++) {
+            fillPacket(buf + p * DATABUF_LEN);
+        }
+        stats.completed++;
+        *len = size;
+        if (fault(simFaults.badChannels)) {
+            int word = rng() % (size / 4);
+            buf[word * 4] = (buf[word * 4] & 0x0f) | 0xf0;
+        }
+        // Короткий запрос, как и у настоящего USB, содержит только целые пакеты,
+        // отсчеты остальных пакетов потеряны
+        uint64_t lastSample = endSamples - 1;
+        if (fault(simFaults.shortReads)) {
+            int packets = rng() % (size / DATABUF_LEN);
+            if (packets > 0) {
+                lastSample -= (uint64_t)(size / DATABUF_LEN - packets) * CHANBUF_LEN;
+            }
+            *len = packets * DATABUF_LEN;
+            stats.shortTransfers++;
+        }
+        int64_t usec = startUsec + (int64_t)(lastSample * 1000000 / freq);
+        tv->tv_sec = usec / 1000000;
+        tv->tv_usec = usec % 1000000;
+        return SUCCESS;
+    }
+}
+
+/**
+ * Остановка формирования данных.
+ * @return - код ошибки.
+ */
+int8_t SimDevice::stop() {
+    running = false;
+    return SUCCESS;
+}
+
+/**
+ * Закрытие имитатора.
+ */
+void SimDevice::close() {
+    stop();
+}
+
+/**
+ * @return - произошла ли неисправимая ошибка чтения.
+ */
+bool SimDevice::failed() {
+    return false;
+}
+
+/**
+ * @return - счетчики чтения.
+ */
+DeviceStats SimDevice::getStats() {
+    return stats;
+}
+
+/**
+ * @return - название устройства.
+ */
+const char *SimDevice::name() {
+    return paced ? "simulator" : "simulator (max speed)";
+}
+
+/**
+ * Выбор, вносить ли ошибку в очередной запрос.
+ * @param rate - частота ошибки (на SIM_FAULT_BASE запросов).
+ * @return - вносить ли ошибку.
+ */
+bool SimDevice::fault(uint32_t rate) {
+    return rate > 0 && rng() % SIM_FAULT_BASE < rate;
+}
+
+/**
+ * Формирование одного пакета: каналы 0..3 по очереди,
+ * в канале c синусоида с периодом SIM_TABLE_LEN / (c + 1) отсчетов и шум.
+ * @param buf - пакет длиной DATABUF_LEN.
+ */
+void SimDevice::fillPacket(uint8_t *buf) {
+    for (int i = 0; i < CHANBUF_LEN; i++) {
+        uint64_t sample = samples + i;
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+            int32_t value = table[(sample * (c + 1)) % SIM_TABLE_LEN] + (int32_t)(rng() % (2 * SIM_NOISE)) - SIM_NOISE;
+            uint8_t *word = buf + (i * NUM_CHANNELS + c) * 4;
+            word[0] = c << 4;
+            word[1] = value & 0xff;
+            word[2] = (value >> 8) & 0xff;
+            word[3] = (value >> 16) & 0xff;
+        }
+    }
+    samples += CHANBUF_LEN;
+}
@@ -0,0 +1,85 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_SIMDEVICE_H
+#define ADCCOLLECTOR_SIMDEVICE_H
+#include <chrono>
+#include <random>
+#include <vector>
+#include "adcdevice.h"
+#include "logger.h"
+
+// Signal table length (one period)
+#define SIM_TABLE_LEN 4096
+// Signal amplitude (ADC counts)
+#define SIM_AMPLITUDE 0x300000
+// Noise amplitude (ADC counts)
+#define SIM_NOISE 0x100
+// Fault rates are given per SIM_FAULT_BASE transfers
+#define SIM_FAULT_BASE 1000
+
+/**
+ * Частота внесения ошибок (на SIM_FAULT_BASE запросов).
+ */
+struct SimFaults {
+    uint32_t shortReads;
+    uint32_t timeouts;
+    uint32_t badChannels;
+};
+
+/**
+ * Имитатор АЦП ЛА-И24USB. Формирует пакеты того же формата, что и устройство,
+ * с синусоидой своей частоты и шумом в каждом канале, в реальном времени
+ * или с максимальной скоростью. Время пакетов отсчитывается от момента запуска
+ * по номеру отсчета, поэтому и в ускоренном режиме файлы делятся по часам
+ * так же, как при записи с устройства. Может вносить ошибки: неполные
+ * и потерянные по таймауту запросы, слова с неверным номером канала.
+ */
+class SimDevice : public AdcDevice {
+public:
+    SimDevice(Logger *log, bool realtime, SimFaults faults);
+
+    int8_t open() override;
+    int8_t start(int frequency, int transferSize, uint32_t timeout, uint32_t interval) override;
+    int8_t read(uint8_t *buf, int *len, struct timeval *tv, uint32_t timeout) override;
+    int8_t stop() override;
+    void close() override;
+    bool failed() override;
+    DeviceStats getStats() override;
+    const char *name() override;
+
+private:
+    Logger *logger;
+    bool paced;
+    SimFaults simFaults;
+    std::mt19937 rng;
+    std::vector<int32_t> table;
+    bool running = false;
+    int freq = 0;
+    int size = 0;
+    uint64_t transfers = 0;
+    uint64_t samples = 0;
+    int64_t startUsec = 0;
+    std::chrono::steady_clock::time_point startTime;
+    DeviceStats stats {};
+
+    bool fault(uint32_t rate);
+    void fillPacket(uint8_t *buf);
+};
+
+
+#endif //ADCCOLLECTOR_SIMDEVICE_H
@@ -0,0 +1,271 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spectrum.h"
+#include <cmath>
+#include <algorithm>
+#include <unistd.h>
+
+/**
+ * Длина отрезка: степень двойки не меньше заданной.
+ * @param length - заданная длина.
+ * @return - длина отрезка.
+ */
+static size_t segmentLength(int length) {
+    size_t len = SPECTRUM_MIN_LEN;
+    while ((int)len < length) {
+        len *= 2;
+    }
+    return len;
+}
+
+/**
+ * Конструктор, запускает поток расчета.
+ * @param length - длина отрезка (округляется вверх до степени двойки).
+ * @param overlap - перекрытие соседних отрезков (%).
+ * @param frequency - частота отсчетов (Гц).
+ */
+SpectrumWorker::SpectrumWorker(int length, int overlap, double frequency)
+    : fft(segmentLength(length)),
+      ring((size_t)(SPECTRUM_MAX_INTERVAL * frequency) / CHANBUF_LEN + SPECTRUM_RING_SPARE) {
+    len = fft.length();
+    hop = std::max((size_t)1, len * (100 - std::min(std::max(overlap, 0), 99)) / 100);
+    sampleRate = frequency;
+    size_t n = bins();
+
+    window.resize(len);
+    double windowPower = 0;
+    for (size_t i = 0; i < len; i++) {
+        window[i] = (float)(0.5 - 0.5 * cos(2 * M_PI * i / len));
+        windowPower += (double)window[i] * window[i];
+    }
+    // Односторонняя плотность: все частоты, кроме нулевой и Найквиста, учитываются дважды
+    scale.resize(n);
+    for (size_t k = 0; k < n; k++) {
+        scale[k] = (float)((k == 0 || k == n - 1 ? 1.0 : 2.0) / (sampleRate * windowPower));
+    }
+    frame.resize(len);
+    power.resize(n);
+    framesLen = (size_t)(SPECTRUM_MAX_INTERVAL * frequency) / hop + SPECTRUM_FRAMES_SPARE;
+    for (int c = 0; c < NUM_CHANNELS; c++) {
+        chans[c].history.resize(len);
+        chans[c].segments.resize(SPECTRUM_AVERAGES * n);
+        chans[c].sum.resize(n);
+        results[c].resize(n);
+        frameRing[c].resize(framesLen * n);
+    }
+    workerThread = std::thread(&SpectrumWorker::workerLoop, this);
+}
+
+/**
+ * Деструктор, дожидается обработки очереди и останавливает поток.
+ */
+SpectrumWorker::~SpectrumWorker() {
+    running = false;
+    if (workerThread.joinable()) {
+        workerThread.join();
+    }
+}
+
+/**
+ * Постановка блока в очередь расчета (вызывается одним потоком).
+ * @param values - отсчеты по каналам (В).
+ * @return - false, если очередь заполнена и блок пропущен (следующий блок отмечается разрывом).
+ */
+bool SpectrumWorker::push(const float (*values)[CHANBUF_LEN]) {
+    SpectrumBlock *block = ring.acquire();
+    if (block == nullptr) {
+        dropped = true;
+        return false;
+    }
+    std::copy(&values[0][0], &values[0][0] + NUM_CHANNELS * CHANBUF_LEN, &block->values[0][0]);
+    block->gap = dropped;
+    dropped = false;
+    ring.commit();
+    return true;
+}
+
+/**
+ * Выбор рассчитываемых каналов. Расчет канала, который был выключен,
+ * начинается заново.
+ * @param mask - битовая маска каналов.
+ */
+void SpectrumWorker::setChannels(uint32_t mask) {
+    channelMask = mask;
+}
+
+/**
+ * Получение нового спектра канала.
+ * @param channel - номер канала.
+ * @param psd - спектральная плотность мощности (дБ), bins() значений.
+ * @return - false, если с прошлого вызова спектр не обновлялся.
+ */
+bool SpectrumWorker::takeSpectrum(int channel, std::vector<float> *psd) {
+    std::lock_guard<std::mutex> lock(resultMutex);
+    if (!fresh[channel]) {
+        return false;
+    }
+    psd->assign(results[channel].begin(), results[channel].end());
+    fresh[channel] = false;
+    return true;
+}
+
+/**
+ * Получение спектров отрезков, рассчитанных с прошлого вызова.
+ * @param channel - номер канала.
+ * @param frames - спектры (дБ) от старого к новому, по bins() значений.
+ * @param gap - перед спектрами были пропущены отрезки (переполнение кольца
+ * или пропуск блоков в очереди).
+ * @return - число спектров.
+ */
+size_t SpectrumWorker::takeFrames(int channel, std::vector<float> *frames, bool *gap) {
+    size_t n = bins();
+    std::lock_guard<std::mutex> lock(resultMutex);
+    size_t count = frameCount[channel];
+    frames->resize(count * n);
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = (frameHead[channel] + framesLen - count + i) % framesLen;
+        std::copy(&frameRing[channel][slot * n], &frameRing[channel][slot * n] + n, frames->data() + i * n);
+    }
+    frameCount[channel] = 0;
+    // Разрыв сообщается вместе со следующими за ним спектрами
+    *gap = count > 0 && frameGap[channel];
+    if (count > 0) {
+        frameGap[channel] = false;
+    }
+    return count;
+}
+
+/**
+ * @return - число частот спектра (от 0 до частоты Найквиста).
+ */
+size_t SpectrumWorker::bins() {
+    return len / 2 + 1;
+}
+
+/**
+ * @return - шаг по частоте (Гц).
+ */
+double SpectrumWorker::binWidth() {
+    return sampleRate / len;
+}
+
+/**
+ * Основной цикл потока расчета.
+ */
+void SpectrumWorker::workerLoop() {
+    while (true) {
+        SpectrumBlock *block = ring.front();
+        if (block == nullptr) {
+            if (!running) {
+                break;
+            }
+            usleep(SPECTRUM_IDLE_SLEEP);
+            continue;
+        }
+        uint32_t mask = channelMask;
+        for (int c = 0; c < NUM_CHANNELS; c++) {
+            if (block->gap && chans[c].filled > 0) {
+                reset(&chans[c]);
+                std::lock_guard<std::mutex> lock(resultMutex);
+                frameGap[c] = true;
+            }
+            if (mask & (1u << c)) {
+                process(c, block->values[c]);
+            } else if (chans[c].filled > 0) {
+                reset(&chans[c]);
+            }
+        }
+        ring.release();
+    }
+}
+
+/**
+ * Добавление отсчетов канала. Отрезок рассчитывается каждые hop отсчетов,
+ * как только накоплено length отсчетов.
+ * @param channel - номер канала.
+ * @param values - CHANBUF_LEN отсчетов.
+ */
+void SpectrumWorker::process(int channel, const float *values) {
+    Channel &st = chans[channel];
+    for (int i = 0; i < CHANBUF_LEN; i++) {
+        st.history[st.pos] = values[i];
+        st.pos = (st.pos + 1) & (len - 1);
+        st.filled = std::min(st.filled + 1, len);
+        st.sinceSegment++;
+        if (st.filled == len && st.sinceSegment >= hop) {
+            segment(channel);
+            st.sinceSegment = 0;
+        }
+    }
+}
+
+/**
+ * Расчет спектра последнего отрезка и обновление среднего.
+ * @param channel - номер канала.
+ */
+void SpectrumWorker::segment(int channel) {
+    Channel &st = chans[channel];
+    size_t n = bins();
+    // Кольцо истории начинается с самого старого отсчета в позиции pos
+    for (size_t i = 0; i < len; i++) {
+        frame[i] = st.history[(st.pos + i) & (len - 1)] * window[i];
+    }
+    fft.power(frame.data(), power.data());
+
+    float *slot = &st.segments[st.next * n];
+    for (size_t k = 0; k < n; k++) {
+        float p = power[k] * scale[k];
+        st.sum[k] += (double)p - slot[k];
+        slot[k] = p;
+    }
+    st.next = (st.next + 1) % SPECTRUM_AVERAGES;
+    st.count = std::min(st.count + 1, (size_t)SPECTRUM_AVERAGES);
+
+    std::lock_guard<std::mutex> lock(resultMutex);
+    std::vector<float> &psd = results[channel];
+    for (size_t k = 0; k < n; k++) {
+        psd[k] = (float)(10 * log10(std::max(st.sum[k], 0.0) / st.count + SPECTRUM_FLOOR));
+    }
+    fresh[channel] = true;
+
+    float *frameOut = &frameRing[channel][frameHead[channel] * n];
+    for (size_t k = 0; k < n; k++) {
+        frameOut[k] = (float)(10 * log10(slot[k] + SPECTRUM_FLOOR));
+    }
+    frameHead[channel] = (frameHead[channel] + 1) % framesLen;
+    if (frameCount[channel] == framesLen) {
+        // Самый старый спектр потерян
+        frameGap[channel] = true;
+    } else {
+        frameCount[channel]++;
+    }
+}
+
+/**
+ * Сброс расчета канала.
+ * @param st - состояние канала.
+ */
+void SpectrumWorker::reset(Channel *st) {
+    st->pos = 0;
+    st->filled = 0;
+    st->sinceSegment = 0;
+    st->next = 0;
+    st->count = 0;
+    std::fill(st->segments.begin(), st->segments.end(), 0.0f);
+    std::fill(st->sum.begin(), st->sum.end(), 0.0);
+}
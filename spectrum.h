@@ -0,0 +1,124 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_SPECTRUM_H
+#define ADCCOLLECTOR_SPECTRUM_H
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "adcdefs.h"
+#include "spscring.h"
+#include "fft.h"
+
+// Longest chart update interval (sec): the GUI -> spectrum queue holds all blocks of one update
+#define SPECTRUM_MAX_INTERVAL 60
+// Blocks in the GUI -> spectrum queue beyond one update
+#define SPECTRUM_RING_SPARE 256
+// Shortest segment (samples)
+#define SPECTRUM_MIN_LEN 16
+// Segments averaged by the Welch method
+#define SPECTRUM_AVERAGES 8
+// Segment spectra kept per channel beyond those of SPECTRUM_MAX_INTERVAL, until taken for the waterfall
+#define SPECTRUM_FRAMES_SPARE 16
+// Sleep of the spectrum thread when the queue is empty (usec)
+#define SPECTRUM_IDLE_SLEEP 5000
+// Power density added before taking the logarithm (V^2/Hz)
+#define SPECTRUM_FLOOR 1e-20
+
+/**
+ * Блок отсчетов для расчета спектра: все отсчеты блока каждого канала (В).
+ * gap - перед блоком пропущены блоки, не поместившиеся в очередь.
+ */
+struct SpectrumBlock {
+    float values[NUM_CHANNELS][CHANBUF_LEN];
+    bool gap;
+};
+
+/**
+ * Расчет спектральной плотности мощности каналов методом Уэлча в отдельном
+ * потоке. Отрезки длины length с перекрытием overlap взвешиваются окном
+ * Ханна, их спектры усредняются по последним SPECTRUM_AVERAGES отрезкам.
+ * Результат (дБ относительно 1 В^2/Гц) обновляется после каждого отрезка.
+ * После пропуска блоков расчет начинается заново, чтобы отрезки не
+ * склеивались из несмежных данных.
+ * Спектры отдельных отрезков (кадры водопада) копятся в кольце, рассчитанном
+ * на самый длинный интервал обновления, пока их не заберут.
+ * Все буферы выделяются в конструкторе.
+ */
+class SpectrumWorker {
+public:
+    SpectrumWorker(int length, int overlap, double frequency);
+    ~SpectrumWorker();
+
+    bool push(const float (*values)[CHANBUF_LEN]);
+    void setChannels(uint32_t mask);
+    bool takeSpectrum(int channel, std::vector<float> *psd);
+    size_t takeFrames(int channel, std::vector<float> *frames, bool *gap);
+    size_t bins();
+    double binWidth();
+
+private:
+    /**
+     * Состояние расчета одного канала.
+     */
+    struct Channel {
+        std::vector<float> history;
+        size_t pos = 0;
+        size_t filled = 0;
+        size_t sinceSegment = 0;
+        std::vector<float> segments;
+        std::vector<double> sum;
+        size_t next = 0;
+        size_t count = 0;
+    };
+
+    size_t len;
+    size_t hop;
+    double sampleRate;
+    RealFft fft;
+    std::vector<float> window;
+    std::vector<float> scale;
+    std::vector<float> frame;
+    std::vector<float> power;
+    Channel chans[NUM_CHANNELS];
+
+    SpscRing<SpectrumBlock> ring;
+    bool dropped = false;
+    std::thread workerThread;
+    std::atomic<bool> running {true};
+    std::atomic<uint32_t> channelMask {0};
+
+    std::mutex resultMutex;
+    std::vector<float> results[NUM_CHANNELS];
+    bool fresh[NUM_CHANNELS] = {};
+    size_t framesLen;
+    std::vector<float> frameRing[NUM_CHANNELS];
+    bool frameGap[NUM_CHANNELS] = {};
+    size_t frameHead[NUM_CHANNELS] = {};
+    size_t frameCount[NUM_CHANNELS] = {};
+
+    void workerLoop();
+    void process(int channel, const float *values);
+    void segment(int channel);
+    void reset(Channel *st);
+};
+
+
+#endif //ADCCOLLECTOR_SPECTRUM_H
@@ -0,0 +1,163 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_SPSCRING_H
+#define ADCCOLLECTOR_SPSCRING_H
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#define CACHE_LINE_SIZE 64
+
+/**
+ * Кольцевой буфер без блокировок для одного производителя и одного потребителя.
+ * Память под элементы выделяется один раз при создании, индексы производителя
+ * и потребителя лежат в разных кэш-линиях.
+ */
+template<typename T>
+class SpscRing {
+public:
+    /**
+     * Конструктор кольцевого буфера.
+     * @param capacity - емкость (округляется вверх до степени двойки).
+     */
+    explicit SpscRing(size_t capacity) {
+        size_t len = 2;
+        while(len < capacity) {
+            len <<= 1;
+        }
+        items.resize(len);
+        mask = len - 1;
+    }
+
+    /**
+     * Получение свободного элемента для заполнения (сторона производителя).
+     * Если буфер заполнен, увеличивается счетчик переполнений.
+     * @return - указатель на элемент или nullptr, если буфер заполнен.
+     */
+    T *acquire() {
+        size_t h = head.value.load(std::memory_order_relaxed);
+        if(h - cachedTail >= items.size()) {
+            cachedTail = tail.value.load(std::memory_order_acquire);
+            if(h - cachedTail >= items.size()) {
+                overrunCount.value.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        return &items[h & mask];
+    }
+
+    /**
+     * Публикация элемента, полученного через acquire() (сторона производителя).
+     */
+    void commit() {
+        size_t h = head.value.load(std::memory_order_relaxed) + 1;
+        head.value.store(h, std::memory_order_release);
+        size_t fill = h - tail.value.load(std::memory_order_relaxed);
+        if(fill > highWaterMark.value.load(std::memory_order_relaxed)) {
+            highWaterMark.value.store(fill, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Копирование элемента в буфер (сторона производителя).
+     * @param item - элемент.
+     * @return - false, если буфер заполнен.
+     */
+    bool push(const T &item) {
+        T *slot = acquire();
+        if(slot == nullptr) {
+            return false;
+        }
+        *slot = item;
+        commit();
+        return true;
+    }
+
+    /**
+     * Получение самого старого элемента без удаления (сторона потребителя).
+     * @return - указатель на элемент или nullptr, если буфер пуст.
+     */
+    T *front() {
+        size_t t = tail.value.load(std::memory_order_relaxed);
+        if(t == cachedHead) {
+            cachedHead = head.value.load(std::memory_order_acquire);
+            if(t == cachedHead) {
+                return nullptr;
+            }
+        }
+        return &items[t & mask];
+    }
+
+    /**
+     * Освобождение элемента, полученного через front() (сторона потребителя).
+     */
+    void release() {
+        tail.value.store(tail.value.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @return - текущее число элементов в буфере.
+     */
+    size_t size() const {
+        return head.value.load(std::memory_order_acquire) - tail.value.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return - емкость буфера.
+     */
+    size_t capacity() const {
+        return items.size();
+    }
+
+    /**
+     * @return - максимальное число элементов, находившихся в буфере одновременно.
+     */
+    size_t highWater() const {
+        return highWaterMark.value.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return - число элементов, отброшенных из-за переполнения.
+     */
+    uint64_t overruns() const {
+        return overrunCount.value.load(std::memory_order_relaxed);
+    }
+
+private:
+    template<typename V>
+    struct alignas(CACHE_LINE_SIZE) Padded {
+        std::atomic<V> value {0};
+    };
+
+    std::vector<T> items;
+    size_t mask;
+
+    // Сторона производителя
+    Padded<size_t> head;
+    alignas(CACHE_LINE_SIZE) size_t cachedTail = 0;
+    Padded<size_t> highWaterMark;
+    Padded<uint64_t> overrunCount;
+
+    // Сторона потребителя
+    Padded<size_t> tail;
+    alignas(CACHE_LINE_SIZE) size_t cachedHead = 0;
+};
+
+
+#endif //ADCCOLLECTOR_SPSCRING_H
@@ -0,0 +1,111 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "textencoder.h"
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * Конструктор преобразователя в текст.
+ */
+TextEncoder::TextEncoder() {
+    buf.resize(TEXT_LINE_LEN * 32);
+}
+
+/**
+ * Установка шага времени между отсчетами и точности времени.
+ * @param frequency - частота дискретизации (Гц).
+ * @param aver - коэффициент усреднения (0 - без усреднения).
+ * @param precision - число знаков долей секунды (0, 3 или 6).
+ */
+void TextEncoder::setTiming(int frequency, int aver, int precision) {
+    stepUsec = frequency > 0 ? (int64_t)(aver > 0 ? aver : 1) * 1000000 / frequency : 0;
+    digits = precision == 3 || precision == 6 ? precision : 0;
+}
+
+/**
+ * Преобразование блока отсчетов в текст.
+ * @param data - отсчеты АЦП.
+ * @param len - число отсчетов.
+ * @param tv - время первого отсчета блока.
+ * @return - длина полученного текста (байт).
+ */
+size_t TextEncoder::encode(const int32_t *data, size_t len, const struct timeval *tv) {
+    if (buf.size() < len * TEXT_LINE_LEN) {
+        buf.resize(len * TEXT_LINE_LEN);
+    }
+    time_t sec = tv->tv_sec;
+    int64_t usec = tv->tv_usec;
+    char *p = buf.data();
+    for (size_t i = 0; i < len; i++) {
+        char *line = p;
+        if (sec != cachedSec) {
+            renderPrefix(sec);
+        }
+        memcpy(p, prefix, TIME_PREFIX_LEN);
+        p += TIME_PREFIX_LEN;
+        if (digits > 0) {
+            // Доли секунды: миллисекунды или микросекунды
+            uint32_t frac = digits == 3 ? usec / 1000 : usec;
+            *p++ = '.';
+            for (int d = digits - 1; d >= 0; d--) {
+                p[d] = '0' + frac % 10;
+                frac /= 10;
+            }
+            p += digits;
+        }
+        usec += stepUsec;
+        while (usec >= 1000000) {
+            usec -= 1000000;
+            sec++;
+        }
+        *p++ = ' ';
+        *p++ = ' ';
+        float val = (float)data[i] / 0x7fffff00 * 2.500;
+        p = std::to_chars(p, line + TEXT_LINE_LEN - 1, val, std::chars_format::fixed, 6).ptr;
+        *p++ = '\n';
+    }
+    used = p - buf.data();
+    return used;
+}
+
+/**
+ * @return - текст последнего блока.
+ */
+const char *TextEncoder::data() {
+    return buf.data();
+}
+
+/**
+ * @return - длина текста последнего блока (байт).
+ */
+size_t TextEncoder::size() {
+    return used;
+}
+
+/**
+ * Формирование префикса времени для новой секунды.
+ * @param sec - время (сек).
+ */
+void TextEncoder::renderPrefix(time_t sec) {
+    struct tm tm;
+    gmtime_r(&sec, &tm);
+    snprintf(prefix, sizeof(prefix), "%04d-%02d-%02d %02d:%02d:%02d",
+             tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    cachedSec = sec;
+}
@@ -0,0 +1,59 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_TEXTENCODER_H
+#define ADCCOLLECTOR_TEXTENCODER_H
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <sys/time.h>
+
+// Max length of one text line
+#define TEXT_LINE_LEN 64
+// Length of "YYYY-MM-DD HH:MM:SS" prefix
+#define TIME_PREFIX_LEN 19
+
+/**
+ * Преобразование блока отсчетов в текст вида "YYYY-MM-DD HH:MM:SS.mmm  value".
+ * Время каждого отсчета отсчитывается от времени блока с шагом, заданным
+ * частотой дискретизации и коэффициентом усреднения. Префикс даты и времени
+ * формируется один раз в секунду, доли секунды и значения дописываются
+ * в переиспользуемый буфер блока.
+ */
+class TextEncoder {
+public:
+    TextEncoder();
+
+    void setTiming(int frequency, int aver, int precision);
+    size_t encode(const int32_t *data, size_t len, const struct timeval *tv);
+    const char *data();
+    size_t size();
+
+private:
+    std::vector<char> buf;
+    size_t used = 0;
+    time_t cachedSec = -1;
+    char prefix[TEXT_LINE_LEN];
+    int64_t stepUsec = 0;
+    int digits = 0;
+
+    void renderPrefix(time_t sec);
+};
+
+
+#endif //ADCCOLLECTOR_TEXTENCODER_H
@@ -0,0 +1,323 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "usbdevice.h"
+#include "adcdefs.h"
+#include <unistd.h>
+
+/**
+ * Конструктор АЦП, подключенного по USB.
+ * @param log - журнал.
+ * @param queueDepth - число одновременно отправленных запросов чтения.
+ */
+UsbDevice::UsbDevice(Logger *log, int queueDepth) {
+    logger = log;
+    depth = queueDepth;
+}
+
+/**
+ * Деструктор. Останавливает чтение и закрывает устройство.
+ */
+UsbDevice::~UsbDevice() {
+    close();
+}
+
+/**
+ * Инициализация подсистемы USB и открытие устройства.
+ * @return - код ошибки.
+ */
+int8_t UsbDevice::open() {
+    int res = libusb_init(&usbContext);
+    if (res < 0) {
+        logger->logging(FATAL, "USB init error");
+        usbContext = NULL;
+        return ADC_OPEN_ERROR;
+    }
+
+    logger->logging(INFO, "Open ADC...");
+    libusb_device **devices;
+    ssize_t cnt = libusb_get_device_list(usbContext, &devices);
+    if (cnt < 0) {
+        logger->logging(FATAL, "Get devices list error");
+        return ADC_OPEN_ERROR;
+    }
+    for(int32_t i = 0; i < cnt; i++) {
+        struct libusb_device_descriptor desc;
+        res = libusb_get_device_descriptor(devices[i], &desc);
+        if (res < 0) {
+            logger->logging(FATAL, "Failed to get device descriptor");
+            break;
+        }
+        if (desc.idVendor == VENDOR_ID && desc.idProduct == PRODUCT_ID) {
+            res = libusb_open(devices[i], &devHandle);
+            if (res < 0) {
+                logger->logging(FATAL, "Failed to open device");
+                devHandle = NULL;
+            }
+            break;
+        }
+    }
+    libusb_free_device_list(devices, 1);
+    if (devHandle == NULL) {
+        logger->logging(FATAL, "ADC not found");
+        return ADC_OPEN_ERROR;
+    }
+    logger->logging(INFO, "ADC opened successfully.");
+    return SUCCESS;
+}
+
+/**
+ * Запуск АЦП и асинхронного чтения.
+ * @param frequency - частота дискретизации (Гц).
+ * @param transferSize - размер одного запроса (байт).
+ * @param timeout - таймаут одного запроса (msec).
+ * @param interval - ожидаемый интервал между запросами (msec).
+ * @return - код ошибки.
+ */
+int8_t UsbDevice::start(int frequency, int transferSize, uint32_t timeout, uint32_t interval) {
+    if (devHandle == NULL) {
+        logger->logging(FATAL, "Attempt to start ADC without opening it");
+        return ADC_FAILURE;
+    }
+    if (reader && !reader->idle()) {
+        logger->logging(FATAL, "Previous USB transfers did not complete");
+        return ADC_FAILURE;
+    }
+    started = true;
+    int8_t res = startAdc(frequency);
+    if (res != SUCCESS) {
+        return res;
+    }
+    reader.reset(new UsbReader(usbContext, devHandle, EPIN1, depth, transferSize, timeout, interval));
+    res = reader->start();
+    if (res != SUCCESS) {
+        logger->logging(FATAL, "Cannot start asynchronous reading");
+    }
+    return res;
+}
+
+/**
+ * Получение очередного принятого буфера.
+ * @param buf - выходной буфер (не меньше размера запроса).
+ * @param len - число принятых байт.
+ * @param tv - время завершения запроса.
+ * @param timeout - время ожидания (msec).
+ * @return - код ошибки.
+ */
+int8_t UsbDevice::read(uint8_t *buf, int *len, struct timeval *tv, uint32_t timeout) {
+    if (!reader) {
+        *len = 0;
+        return ADC_FAILURE;
+    }
+    return reader->read(buf, len, tv, timeout);
+}
+
+/**
+ * Остановка чтения и АЦП.
+ * @return - код ошибки.
+ */
+int8_t UsbDevice::stop() {
+    if (reader) {
+        reader->stop();
+    }
+    if (!started) {
+        return SUCCESS;
+    }
+    started = false;
+    int8_t res = stopAdc();
+    if (res != SUCCESS) {
+        logger->logging(ERROR, "Failed to stop ADC, ADC error");
+    }
+    return res;
+}
+
+/**
+ * Закрытие устройства и подсистемы USB.
+ */
+void UsbDevice::close() {
+    stop();
+    if (reader && !reader->idle()) {
+        // Незавершенные запросы ссылаются на чтение и дескриптор устройства,
+        // поэтому они остаются открытыми до завершения программы
+        logger->logging(ERROR, "USB transfers did not complete, ADC is left open");
+        reader.release();
+        devHandle = NULL;
+        usbContext = NULL;
+        return;
+    }
+    reader.reset();
+    if (devHandle) {
+        logger->logging(INFO, "Closing ADC");
+        libusb_close(devHandle);
+        devHandle = NULL;
+    }
+    if (usbContext) {
+        libusb_exit(usbContext);
+        usbContext = NULL;
+    }
+}
+
+/**
+ * @return - произошла ли неисправимая ошибка чтения.
+ */
+bool UsbDevice::failed() {
+    return reader && reader->failed();
+}
+
+/**
+ * @return - счетчики чтения.
+ */
+DeviceStats UsbDevice::getStats() {
+    if (!reader) {
+        return DeviceStats {};
+    }
+    return reader->getStats();
+}
+
+/**
+ * @return - название устройства.
+ */
+const char *UsbDevice::name() {
+    return "LA-I24USB";
+}
+
+/**
+ * Отправка команды на устройство.
+ * @param b1 - первый байт команды.
+ * @param b2 - второй байт команды.
+ * @param b3 - третий байт команды.
+ * @param b4 - четвертый байт команды.
+ * @param delay - задержка (msec).
+ * @return - число байт, переданных на устройство.
+ */
+uint8_t UsbDevice::sendCmd(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint32_t delay) {
+    uint8_t cmd[4];
+    cmd[0] = b1;
+    cmd[1] = b2;
+    cmd[2] = b3;
+    cmd[3] = b4;
+    int len = 0;
+    libusb_bulk_transfer(devHandle, EPOUT1, cmd, 4, &len, BULK_TRANSFER_TIMEOUT);
+    usleep(delay * 1000);
+    return len;
+}
+
+/**
+ * Запуск АЦП.
+ * @param frequency - частота дискретизации (Гц).
+ * @return - код ошибки.
+ */
+int8_t UsbDevice::startAdc(int frequency) {
+    int status;
+    status = sendCmd(C_START_STOP, 0, 0, 0, 1);
+    if (status != 4) {
+        logger->logging(FATAL, "Stop ADC: cannot send command");
+        return ADC_FAILURE;
+    }
+    status = sendCmd(C_RESET, 0, 0, 0, 1);
+    if (status != 4) {
+        logger->logging(FATAL, "Reset ADC: cannot send command");
+        return ADC_FAILURE;
+    }
+    status = sendCmd(C_FREQ_SET, 0, 0, FREQ_800, 1);
+    if (status != 4) {
+        logger->logging(FATAL, "Set frequency: cannot send command");
+        return ADC_FAILURE;
+    }
+    status = sendCmd(C_GAIN_SET, 0, 0, 0, 100);
+    if (status != 4) {
+        logger->logging(FATAL, "Set gain on channel 1: cannot send command");
+        return ADC_FAILURE;
+    }
+    status = sendCmd(C_GAIN_SET, 1, 0, 0, 100);
+    if (status != 4) {
+        logger->logging(FATAL, "Set gain on channel 2: cannot send command");
+        return ADC_FAILURE;
+    }
+    status = sendCmd(C_GAIN_SET, 2, 0, 0, 100);
+    if (status != 4) {
+        logger->logging(FATAL, "Set gain on channel 3: cannot send command");
+        return ADC_FAILURE;
+    }
+    status = sendCmd(C_GAIN_SET, 3, 0, 0, 100);
+    if (status != 4) {
+        logger->logging(FATAL, "Set gain on channel 4: cannot send command");
+        return ADC_FAILURE;
+    }
+    status = sendCmd(C_FREQ_SET, 0, 0, getAdcFreq(frequency), 1);
+    if (status != 4) {
+        logger->logging(FATAL, "Set frequency: cannot send command");
+        return ADC_FAILURE;
+    }
+    status = sendCmd(C_START_STOP, 1, 0, 0, 1);
+    if (status != 4) {
+        logger->logging(FATAL, "Start ADC: cannot send command");
+        return ADC_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Остановка АЦП.
+ * @return - код ошибки.
+ */
+int8_t UsbDevice::stopAdc() {
+    int status;
+    status = sendCmd(C_START_STOP, 0, 0, 0, 1);
+    if (status != 4) {
+        logger->logging(FATAL, "Stop ADC: cannot send command");
+        return ADC_FAILURE;
+    }
+    status = sendCmd(C_RESET, 0, 0, 0, 1);
+    if (status != 4) {
+        logger->logging(FATAL, "Reset ADC: cannot send command");
+        return ADC_FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+ * Получение кода установки частоты АЦП.
+ * @param freq - частота в Гц.
+ * @return - код частоты.
+ */
+uint8_t UsbDevice::getAdcFreq(int freq) {
+    uint8_t result;
+    switch(freq) {
+        case 25:
+            result = FREQ_25;
+            break;
+        case 50:
+            result = FREQ_50;
+            break;
+        case 100:
+            result = FREQ_100;
+            break;
+        case 200:
+            result = FREQ_200;
+            break;
+        case 400:
+            result = FREQ_400;
+            break;
+        case 800:
+            result = FREQ_800;
+            break;
+        default:
+            result = FREQ_100;
+    }
+    return result;
+}
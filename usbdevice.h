@@ -0,0 +1,90 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_USBDEVICE_H
+#define ADCCOLLECTOR_USBDEVICE_H
+#include <memory>
+#include <libusb-1.0/libusb.h>
+#include "adcdevice.h"
+#include "usbreader.h"
+#include "logger.h"
+
+// Vendor & product IDs
+#define VENDOR_ID    0x534B
+#define PRODUCT_ID   0xC372
+// ADC endpoint addresses
+#define EPOUT1       0x02
+#define EPOUT2       0x04
+#define EPIN1        0x86
+#define EPIN2        0x88
+// ADC command set
+#define C_START_STOP 0x01
+#define C_POWER      0x02
+#define C_GET_STATUS 0x03
+#define C_FREQ_SET   0x04
+#define C_CHAN_USE   0x0A
+#define C_SYNC       0x12
+#define C_GAIN_SET   0x18
+#define C_PORT_OUT   0x20
+#define C_PORT_IN    0x21
+#define C_DAC_OUT    0x23
+#define C_RESET      0x32
+#define C_REG_WRITE  0xB0
+#define C_REG_READ   0x70
+// Frequency
+#define FREQ_25      0x82
+#define FREQ_50      0x83
+#define FREQ_100     0x84
+#define FREQ_200     0x85
+#define FREQ_400     0x86
+#define FREQ_800     0x87
+// Command transfer timeout (msec)
+#define BULK_TRANSFER_TIMEOUT 2000
+
+/**
+ * АЦП ЛА-И24USB, подключенный по USB.
+ */
+class UsbDevice : public AdcDevice {
+public:
+    UsbDevice(Logger *log, int queueDepth);
+    ~UsbDevice() override;
+
+    int8_t open() override;
+    int8_t start(int frequency, int transferSize, uint32_t timeout, uint32_t interval) override;
+    int8_t read(uint8_t *buf, int *len, struct timeval *tv, uint32_t timeout) override;
+    int8_t stop() override;
+    void close() override;
+    bool failed() override;
+    DeviceStats getStats() override;
+    const char *name() override;
+
+private:
+    Logger *logger;
+    int depth;
+    libusb_context *usbContext = NULL;
+    libusb_device_handle *devHandle = NULL;
+    std::unique_ptr<UsbReader> reader;
+    bool started = false;
+
+    uint8_t sendCmd(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint32_t delay);
+    int8_t startAdc(int frequency);
+    int8_t stopAdc();
+    uint8_t getAdcFreq(int freq);
+};
+
+
+#endif //ADCCOLLECTOR_USBDEVICE_H
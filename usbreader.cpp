@@ -0,0 +1,277 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "usbreader.h"
+#include "adcdefs.h"
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+/**
+ * Конструктор асинхронного чтения.
+ * @param context - контекст libusb.
+ * @param handle - дескриптор устройства.
+ * @param endpoint - адрес конечной точки.
+ * @param queueDepth - число одновременно отправленных запросов.
+ * @param transferSize - размер одного запроса (байт).
+ * @param timeout - таймаут одного запроса (msec).
+ * @param expectedInterval - ожидаемый интервал между завершениями запросов (msec).
+ */
+UsbReader::UsbReader(libusb_context *context, libusb_device_handle *handle, uint8_t endpoint,
+                     int queueDepth, int transferSize, uint32_t timeout, uint32_t expectedInterval) {
+    usbContext = context;
+    devHandle = handle;
+    ep = endpoint;
+    depth = queueDepth > 0 ? queueDepth : 1;
+    size = transferSize;
+    transferTimeout = timeout;
+    interval = expectedInterval;
+    ready.resize(depth * READY_QUEUE_FACTOR);
+    for(auto &slot : ready) {
+        slot.data.resize(size);
+        slot.len = 0;
+    }
+}
+
+/**
+ * Деструктор. Останавливает чтение и освобождает запросы.
+ * Все запросы должны быть завершены (idle()): незавершенные запросы ссылаются
+ * на этот объект, поэтому чтение с ними не удаляется, а оставляется (см. UsbDevice).
+ */
+UsbReader::~UsbReader() {
+    stop();
+    assert(idle());
+    freeTransfers();
+}
+
+/**
+ * Запуск чтения: выделение и отправка всех запросов, запуск потока обработки событий.
+ * @return - код ошибки.
+ */
+int8_t UsbReader::start() {
+    if(usbContext == NULL || devHandle == NULL) {
+        return ADC_FAILURE;
+    }
+    for(int i = 0; i < depth; i++) {
+        libusb_transfer *transfer = libusb_alloc_transfer(0);
+        if(transfer == NULL) {
+            freeTransfers();
+            return ADC_FAILURE;
+        }
+        transferBufs.emplace_back(size);
+        libusb_fill_bulk_transfer(transfer, devHandle, ep, transferBufs.back().data(), size,
+                                  transferCallback, this, transferTimeout);
+        transfers.push_back(transfer);
+    }
+
+    failure = false;
+    running = true;
+    eventThread = std::thread(&UsbReader::eventLoop, this);
+
+    for(libusb_transfer *transfer : transfers) {
+        inFlight++;
+        if(libusb_submit_transfer(transfer) < 0) {
+            inFlight--;
+            failure = true;
+            stop();
+            return ADC_FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * Остановка чтения: отмена запросов и ожидание их завершения
+ * (запросы отменяет поток обработки событий).
+ */
+void UsbReader::stop() {
+    running = false;
+    if(eventThread.joinable()) {
+        eventThread.join();
+    }
+    queueCond.notify_all();
+}
+
+/**
+ * Получение очередного принятого буфера.
+ * @param buf - выходной буфер (не меньше размера запроса).
+ * @param len - число принятых байт.
+ * @param tv - время завершения запроса.
+ * @param timeout - время ожидания (msec).
+ * @return - код ошибки.
+ */
+int8_t UsbReader::read(uint8_t *buf, int *len, struct timeval *tv, uint32_t timeout) {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    bool hasData = queueCond.wait_for(lock, std::chrono::milliseconds(timeout), [this] {
+        return readyCount > 0 || failure;
+    });
+    if(!hasData || readyCount == 0) {
+        *len = 0;
+        return ADC_FAILURE;
+    }
+    Slot &slot = ready[readyHead];
+    memcpy(buf, slot.data.data(), slot.len);
+    *len = slot.len;
+    *tv = slot.tv;
+    readyHead = (readyHead + 1) % ready.size();
+    readyCount--;
+    return SUCCESS;
+}
+
+/**
+ * @return - произошла ли неисправимая ошибка чтения.
+ */
+bool UsbReader::failed() {
+    return failure;
+}
+
+/**
+ * @return - завершены ли все отправленные запросы.
+ */
+bool UsbReader::idle() {
+    return inFlight == 0;
+}
+
+/**
+ * @return - счетчики чтения.
+ */
+DeviceStats UsbReader::getStats() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return stats;
+}
+
+/**
+ * Функция обратного вызова libusb.
+ * @param transfer - завершенный запрос.
+ */
+void LIBUSB_CALL UsbReader::transferCallback(struct libusb_transfer *transfer) {
+    static_cast<UsbReader*>(transfer->user_data)->onTransfer(transfer);
+}
+
+/**
+ * Обработка завершенного запроса: сохранение данных и повторная отправка.
+ * @param transfer - завершенный запрос.
+ */
+void UsbReader::onTransfer(struct libusb_transfer *transfer) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    switch(transfer->status) {
+        case LIBUSB_TRANSFER_COMPLETED:
+        case LIBUSB_TRANSFER_TIMED_OUT: {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if(transfer->status == LIBUSB_TRANSFER_TIMED_OUT) {
+                stats.timeouts++;
+            } else {
+                stats.completed++;
+                if(transfer->actual_length != transfer->length) {
+                    stats.shortTransfers++;
+                }
+            }
+            if(interval > 0 && lastCompletion.tv_sec != 0) {
+                int64_t dt = (int64_t)(tv.tv_sec - lastCompletion.tv_sec) * 1000 +
+                             (tv.tv_usec - lastCompletion.tv_usec) / 1000;
+                if(dt > 2 * (int64_t)interval) {
+                    stats.late++;
+                }
+            }
+            lastCompletion = tv;
+            break;
+        }
+        case LIBUSB_TRANSFER_CANCELLED:
+            inFlight--;
+            return;
+        default: {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stats.errors++;
+            failure = true;
+            inFlight--;
+            queueCond.notify_all();
+            return;
+        }
+    }
+
+    if(transfer->actual_length > 0) {
+        pushReady(transfer->buffer, transfer->actual_length, &tv);
+    }
+
+    if(!running) {
+        inFlight--;
+        return;
+    }
+    if(libusb_submit_transfer(transfer) < 0) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stats.errors++;
+        failure = true;
+        inFlight--;
+        queueCond.notify_all();
+    }
+}
+
+/**
+ * Копирование принятых данных в очередь готовых буферов.
+ * Если потребитель не успевает, буфер отбрасывается.
+ * @param data - принятые данные.
+ * @param len - длина данных.
+ * @param tv - время приема.
+ */
+void UsbReader::pushReady(const uint8_t *data, int len, struct timeval *tv) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if(readyCount == ready.size()) {
+        stats.dropped++;
+        return;
+    }
+    Slot &slot = ready[(readyHead + readyCount) % ready.size()];
+    memcpy(slot.data.data(), data, len);
+    slot.len = len;
+    slot.tv = *tv;
+    readyCount++;
+    queueCond.notify_one();
+}
+
+/**
+ * Цикл обработки событий libusb. После остановки отменяет запросы
+ * и продолжается, пока не придут все обратные вызовы.
+ */
+void UsbReader::eventLoop() {
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    while(running || inFlight > 0) {
+        if(!running && deadline == std::chrono::steady_clock::time_point::max()) {
+            // Отмена из этого потока не пересекается с повторной отправкой в onTransfer
+            for(libusb_transfer *transfer : transfers) {
+                libusb_cancel_transfer(transfer);
+            }
+            deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(transferTimeout + 1000);
+        }
+        if(std::chrono::steady_clock::now() > deadline) {
+            break;
+        }
+        struct timeval tv = {0, USB_EVENTS_TIMEOUT * 1000};
+        libusb_handle_events_timeout_completed(usbContext, &tv, NULL);
+    }
+}
+
+/**
+ * Освобождение запросов и их буферов (ни один запрос не должен быть отправлен).
+ */
+void UsbReader::freeTransfers() {
+    for(libusb_transfer *transfer : transfers) {
+        libusb_free_transfer(transfer);
+    }
+    transfers.clear();
+    transferBufs.clear();
+}
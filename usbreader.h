@@ -0,0 +1,92 @@
+/*Copyright (C) 2021 Daria Gurieva
+ This file is part of ADCCollector <https://github.com/dGurieva/ADCCollector>.
+
+ ADCCollector is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ ADCCollector is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with ADCCollector. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADCCOLLECTOR_USBREADER_H
+#define ADCCOLLECTOR_USBREADER_H
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <sys/time.h>
+#include <libusb-1.0/libusb.h>
+#include "adcdevice.h"
+
+// Number of ready slots per in-flight transfer
+#define READY_QUEUE_FACTOR 16
+// Event handling timeout (msec)
+#define USB_EVENTS_TIMEOUT 100
+
+/**
+ * Асинхронное чтение конечной точки АЦП кольцом из нескольких запросов.
+ * Запросы обрабатываются в отдельном потоке, принятые данные копируются
+ * в очередь готовых буферов, откуда их забирает поток сбора данных.
+ */
+class UsbReader {
+public:
+    UsbReader(libusb_context *context, libusb_device_handle *handle, uint8_t endpoint,
+              int queueDepth, int transferSize, uint32_t timeout, uint32_t expectedInterval);
+    ~UsbReader();
+
+    int8_t start();
+    void stop();
+    int8_t read(uint8_t *buf, int *len, struct timeval *tv, uint32_t timeout);
+    bool failed();
+    bool idle();
+    DeviceStats getStats();
+
+private:
+    struct Slot {
+        std::vector<uint8_t> data;
+        int len;
+        struct timeval tv;
+    };
+
+    libusb_context *usbContext;
+    libusb_device_handle *devHandle;
+    uint8_t ep;
+    int depth;
+    int size;
+    uint32_t transferTimeout;
+    uint32_t interval;
+
+    std::vector<libusb_transfer*> transfers;
+    std::vector<std::vector<uint8_t>> transferBufs;
+    std::thread eventThread;
+    std::atomic<bool> running {false};
+    std::atomic<bool> failure {false};
+    std::atomic<int> inFlight {0};
+
+    std::mutex queueMutex;
+    std::condition_variable queueCond;
+    std::vector<Slot> ready;
+    size_t readyHead = 0;
+    size_t readyCount = 0;
+
+    DeviceStats stats {};
+    struct timeval lastCompletion {};
+
+    static void LIBUSB_CALL transferCallback(struct libusb_transfer *transfer);
+    void onTransfer(struct libusb_transfer *transfer);
+    void pushReady(const uint8_t *data, int len, struct timeval *tv);
+    void eventLoop();
+    void freeTransfers();
+};
+
+
+#endif //ADCCOLLECTOR_USBREADER_H